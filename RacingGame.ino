@@ -10,12 +10,21 @@
 
 void setup() {
   // Initialize LCD screen
-  analogReadResolution(12);
   myScreen.begin();  
+  displayBegin(); //DMA channel of the asynchronous display queue
+  sleepBegin();
+  musicBegin();
+  buttonsBegin(buttonOne, buttonTwo);
+  adcBegin(joystickX, joystickY, xpin, ypin);
+  profBegin();
+  scoreStoreBegin(); //High scores saved in flash
+  menuIdle = idleWork;
 }
 
 void loop() {
   if(current_state < NUM_STATES){
+    PROF_STATE(current_state);
+    PROF_SCOPE(PHASE_STATE);
     (*fsm[current_state].state_function)();
   }
 }
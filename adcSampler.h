@@ -0,0 +1,164 @@
+/**
+ * @file adcSampler.h
+ *
+ * @brief Background ADC sampler: joystick and accelerometer channels converted in sequence, oversampled, filtered and double-buffered
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/** ADC Sampler
+ *
+ * 1. Every ADC_PERIOD_MS a Clock callback converts the ADC_CHANNELS channels in sequence, ADC_OVERSAMPLE times each
+ * 2. The averaged conversions go through a first order low-pass filter (new = old + (raw - old) >> ADC_FILTER_SHIFT)
+ * 3. Results are written in the back buffer, which is then published as front buffer
+ * 4. adcRead returns the latest filtered value of a channel without converting anything, adcLatch converts some now
+ * 5. adcSetPeriod changes the sequence period: pages that do not read the inputs stop the sampler (0), the menus slow
+ *    it down, the game runs it at ADC_PERIOD_MS; after a stop the filter restarts from a fresh conversion
+ * 6. adcWatch --> wake loop() (wakeUp) when the watched channel moves from one of the zones below low, between low and high,
+ *    above high to another, so a page can sleep until the joystick is moved
+ *
+ */
+#define ADC_CHANNELS 4
+#define ADC_PERIOD_MS 5 //Sequence period
+#define ADC_OVERSAMPLE 4 //Conversions averaged per channel and sequence
+#define ADC_FILTER_SHIFT 1 //Low-pass strength: 0 = off
+#define ADC_NO_WATCH 0xFF
+
+typedef enum{
+  ADC_JOY_X,
+  ADC_JOY_Y,
+  ADC_ACC_X,
+  ADC_ACC_Y
+}AdcChannel_t;
+
+typedef struct{
+  uint16_t value[ADC_CHANNELS]; //Filtered 12-bit values
+  uint32_t stamp_us; //End of the sequence
+}AdcFrame_t;
+
+typedef struct{
+  uint32_t sequences; //Sequences converted
+  uint32_t conversions; //Single conversions
+  uint32_t busy_us; //Time spent converting
+}AdcStats_t;
+
+uint8_t adcPins[ADC_CHANNELS];
+AdcFrame_t adcBuffer[2];
+volatile uint8_t adcFront = 0; //Buffer read by the game
+uint16_t adcFilter[ADC_CHANNELS]; //Filter state, 12-bit values << ADC_FILTER_SHIFT
+AdcStats_t adcStats;
+Clock adcClock;
+uint16_t adcPeriod = 0; //Current sequence period, 0 = stopped
+bool adcFresh = true; //No history to filter with
+uint8_t adcWatchChannel = ADC_NO_WATCH;
+uint16_t adcWatchLow, adcWatchHigh;
+uint8_t adcWatchZone = 0;
+
+/** ADC sequence functions
+ *
+ * 1. adcConvert --> convert channel c, oversampled, and write its filtered value in frame
+ * 2. adcSequence --> Clock callback: convert every channel, filter and publish the results
+ *
+ */
+void adcConvert(uint8_t c, AdcFrame_t *frame){
+  uint32_t sum = 0;
+  for(uint8_t k = 0; k < ADC_OVERSAMPLE; k++){ sum += analogRead(adcPins[c]); }
+  uint16_t raw = sum / ADC_OVERSAMPLE;
+
+  if(adcFresh){ adcFilter[c] = raw << ADC_FILTER_SHIFT; } //First sequence: no history to filter with
+  else{ adcFilter[c] += raw - (adcFilter[c] >> ADC_FILTER_SHIFT); }
+  frame->value[c] = adcFilter[c] >> ADC_FILTER_SHIFT;
+}
+
+void adcSequence(){
+  uint32_t start = micros();
+  AdcFrame_t *back = &adcBuffer[adcFront ^ 1];
+
+  for(uint8_t c = 0; c < ADC_CHANNELS; c++){ adcConvert(c, back); }
+  back->stamp_us = micros();
+  adcFront ^= 1; //Publish
+  adcFresh = false;
+
+  if(adcWatchChannel != ADC_NO_WATCH){
+    uint16_t v = back->value[adcWatchChannel];
+    uint8_t zone = (v < adcWatchLow) ? 0 : ((v > adcWatchHigh) ? 2 : 1);
+    if(zone != adcWatchZone){ adcWatchZone = zone; wakeUp(); }
+  }
+
+  adcStats.sequences++;
+  adcStats.conversions += ADC_CHANNELS*ADC_OVERSAMPLE;
+  adcStats.busy_us += back->stamp_us - start;
+}
+
+/** ADC control functions
+ *
+ * 1. adcSetPeriod --> sample every ms milliseconds, 0 stops the sampler; a restart converts a first sequence right away
+ * 2. adcWatch --> watch channel against low and high (ADC_NO_WATCH stops watching), starting from the zone it is in now
+ *
+ */
+void adcSetPeriod(uint16_t ms){
+  if(ms == adcPeriod){ return; }
+  adcClock.stop();
+  if(ms == 0){ adcPeriod = 0; adcFresh = true; return; }
+  if(adcPeriod == 0){ adcSequence(); } //Values valid right away
+  adcPeriod = ms;
+  adcClock.setTimeout(ms);
+  adcClock.setPeriod(ms);
+  adcClock.start();
+}
+
+void adcWatch(uint8_t channel, uint16_t low, uint16_t high){
+  noInterrupts();
+  adcWatchChannel = channel;
+  adcWatchLow = low;
+  adcWatchHigh = high;
+  if(channel != ADC_NO_WATCH){
+    uint16_t v = adcBuffer[adcFront].value[channel];
+    adcWatchZone = (v < low) ? 0 : ((v > high) ? 2 : 1);
+  }
+  interrupts();
+}
+
+/** ADC begin function
+ *
+ * Set 12-bit resolution, convert a first sequence so that values are valid right away, then start sampling
+ *
+ */
+void adcBegin(uint8_t joyX, uint8_t joyY, uint8_t accX, uint8_t accY){
+  adcPins[ADC_JOY_X] = joyX;
+  adcPins[ADC_JOY_Y] = joyY;
+  adcPins[ADC_ACC_X] = accX;
+  adcPins[ADC_ACC_Y] = accY;
+  analogReadResolution(12);
+  adcClock.begin(adcSequence, ADC_PERIOD_MS, ADC_PERIOD_MS);
+  adcSetPeriod(ADC_PERIOD_MS);
+}
+
+/** ADC read functions
+ *
+ * 1. adcRead --> latest filtered value of a channel
+ * 2. adcLatest --> latest complete sequence, all channels from the same instant
+ * 3. adcLatch --> convert the n channels from first right now, through the filter, and publish them with the other
+ *    channels of the latest sequence: a sample as fresh as the conversions (~8 per pair), for whoever reads it last
+ *
+ */
+uint16_t adcRead(uint8_t channel){
+  return adcBuffer[adcFront].value[channel];
+}
+
+AdcFrame_t adcLatest(){
+  return adcBuffer[adcFront];
+}
+
+AdcFrame_t adcLatch(uint8_t first, uint8_t n){
+  noInterrupts(); //A sequence must not publish in between
+  AdcFrame_t *back = &adcBuffer[adcFront ^ 1];
+  *back = adcBuffer[adcFront];
+  for(uint8_t c = first; c < first+n; c++){ adcConvert(c, back); }
+  back->stamp_us = micros();
+  adcFront ^= 1;
+  adcStats.conversions += n*ADC_OVERSAMPLE;
+  AdcFrame_t latched = *back;
+  interrupts();
+  return latched;
+}
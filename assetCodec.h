@@ -0,0 +1,169 @@
+/**
+ * @file assetCodec.h
+ *
+ * @brief Compressed image assets: streaming decoder that draws straight into the display window, without a full-size RAM buffer
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/** Asset Encodings
+ *
+ * Pixels are stored row after row. Assets are generated by host/assetConvert.cpp.
+ * 1. CODEC_RAW --> RGB565, 2 bytes per pixel (high byte first)
+ * 2. CODEC_RLE --> RGB565 packets: header h < 128 is followed by h+1 literal colours, h >= 128 by one colour repeated h-127 times
+ * 3. CODEC_PAL4 --> 4-bit palette indices, two pixels per byte (high nibble first)
+ * 4. CODEC_PAL8 --> 8-bit palette indices, one pixel per byte
+ * 5. CODEC_PAL_RLE --> same packets as CODEC_RLE, on 8-bit palette indices
+ *
+ */
+typedef enum{
+  CODEC_RAW,
+  CODEC_RLE,
+  CODEC_PAL4,
+  CODEC_PAL8,
+  CODEC_PAL_RLE
+}Codec_t;
+
+#define NUM_CODECS 5
+#define RLE_RUN 0x80 //Packet header flag for runs
+#define ASSET_CHUNK 32 //Pixels decoded before each push to the display
+
+/**
+ * Asset descriptor: palette and data stay in flash
+ */
+typedef struct{
+  uint8_t width;
+  uint8_t height;
+  uint8_t codec; //Codec_t
+  uint16_t paletteSize;
+  const uint16_t *palette;
+  const uint8_t *data;
+  uint32_t dataSize; //Bytes of data, palette excluded
+}Asset_t;
+
+/**
+ * Decoder state: enough to resume decoding between two chunks
+ */
+typedef struct{
+  const Asset_t *asset;
+  uint32_t pos; //Next byte of data
+  uint32_t pixel; //Pixels already decoded
+  uint8_t count; //Pixels left in the current RLE packet
+  bool run; //Current RLE packet is a run
+  uint16_t value; //Repeated value of the current run
+  uint8_t x0, y0; //Top-left corner on screen
+}AssetDecoder_t;
+
+uint16_t assetChunk[ASSET_CHUNK];
+
+/** Asset begin function
+ *
+ * Prepare a decoder that draws asset with its top-left corner in (x0, y0)
+ *
+ */
+void assetBegin(AssetDecoder_t *dec, const Asset_t *asset, uint8_t x0, uint8_t y0){
+  memset(dec, 0, sizeof(AssetDecoder_t));
+  dec->asset = asset;
+  dec->x0 = x0;
+  dec->y0 = y0;
+}
+
+/** Asset decode function
+ *
+ * Decode the next n pixels of the asset into out, returns the number of pixels decoded
+ *
+ */
+uint16_t assetDecode(AssetDecoder_t *dec, uint16_t *out, uint16_t n){
+  const Asset_t *a = dec->asset;
+  const uint8_t *data = a->data;
+  uint32_t total = (uint32_t)a->width*a->height;
+  if(dec->pixel + n > total){ n = total - dec->pixel; }
+
+  uint16_t i = 0;
+  switch(a->codec){
+    case CODEC_RAW:
+      for(; i < n; i++, dec->pos += 2){ out[i] = (data[dec->pos] << 8) | data[dec->pos+1]; }
+      break;
+    case CODEC_PAL4:
+      for(; i < n; i++){
+        uint32_t p = dec->pixel + i;
+        uint8_t b = data[p >> 1];
+        out[i] = a->palette[(p & 1) ? (b & 0x0F) : (b >> 4)];
+      }
+      break;
+    case CODEC_PAL8:
+      for(; i < n; i++){ out[i] = a->palette[data[dec->pos++]]; }
+      break;
+    case CODEC_RLE:
+    case CODEC_PAL_RLE:
+      while(i < n){
+        if(dec->count == 0){ //Next packet
+          uint8_t h = data[dec->pos++];
+          dec->run = (h & RLE_RUN) != 0;
+          dec->count = dec->run ? h-127 : h+1;
+          if(dec->run){
+            if(a->codec == CODEC_RLE){ dec->value = (data[dec->pos] << 8) | data[dec->pos+1]; dec->pos += 2; }
+            else{ dec->value = a->palette[data[dec->pos++]]; }
+          }
+        }
+        uint8_t m = min(dec->count, n-i);
+        if(dec->run){
+          for(uint8_t k = 0; k < m; k++){ out[i++] = dec->value; }
+        }
+        else if(a->codec == CODEC_RLE){
+          for(uint8_t k = 0; k < m; k++, dec->pos += 2){ out[i++] = (data[dec->pos] << 8) | data[dec->pos+1]; }
+        }
+        else{
+          for(uint8_t k = 0; k < m; k++){ out[i++] = a->palette[data[dec->pos++]]; }
+        }
+        dec->count -= m;
+      }
+      break;
+  }
+  dec->pixel += n;
+  return n;
+}
+
+/** Asset step function
+ *
+ * Decode and push up to rows rows (0 = all the remaining ones) inside a single address window,
+ * ASSET_CHUNK pixels at a time. Returns true when the whole asset has been drawn.
+ * The asset must fit on screen.
+ *
+ */
+bool assetStep(AssetDecoder_t *dec, uint8_t rows){
+  const Asset_t *a = dec->asset;
+  uint8_t row = dec->pixel / a->width;
+  if(row >= a->height){ return true; }
+
+  uint8_t last = ((rows == 0) || (row + rows > a->height)) ? a->height : row + rows;
+  lcdWindow(dec->x0, dec->y0+row, dec->x0+a->width-1, dec->y0+last-1);
+
+  uint32_t left = (uint32_t)(last-row)*a->width;
+  while(left > 0){
+    uint16_t n = assetDecode(dec, assetChunk, min(left, (uint32_t)ASSET_CHUNK));
+    lcdPushPixels(assetChunk, n);
+    left -= n;
+  }
+  return last >= a->height;
+}
+
+/** Draw asset function
+ *
+ * Draw the whole asset at (x0, y0) with a single address window
+ *
+ */
+void drawAsset(const Asset_t *asset, uint8_t x0, uint8_t y0){
+  AssetDecoder_t dec;
+  assetBegin(&dec, asset, x0, y0);
+  assetStep(&dec, 0);
+}
+
+/** Asset flash size function
+ *
+ * Bytes of flash used by an asset: data, palette and descriptor
+ *
+ */
+uint32_t assetFlashSize(const Asset_t *asset){
+  return asset->dataSize + asset->paletteSize*sizeof(uint16_t) + sizeof(Asset_t);
+}
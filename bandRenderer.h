@@ -0,0 +1,68 @@
+/**
+ * @file bandRenderer.h
+ *
+ * @brief Band renderer: draws the compositor scene off-screen into a strip of BAND_HEIGHT scanlines and pushes each band with one window
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/** Band Renderer
+ *
+ * A full 128x128 RGB565 framebuffer needs 32 KB of RAM, so the scene is rendered one band at a time:
+ * every pixel reaches the panel once, with its final colour, so erase-then-draw flicker and overdraw disappear.
+ * 1. Only bands touched by damage are rendered (every band when full is true)
+ * 2. A band spans the columns of the damage it contains, and is pushed with a single window and a single burst
+ * 3. BAND_HEIGHT trades RAM (BAND_HEIGHT*256 bytes) against SPI transactions (128/BAND_HEIGHT per full frame)
+ *
+ */
+#ifndef BAND_HEIGHT
+#define BAND_HEIGHT 8 //Scanlines per band
+#endif
+
+typedef struct{
+  uint32_t frames; //Frames flushed
+  uint32_t bands; //Bands pushed
+  uint32_t pixels; //Pixels pushed
+}BandStats_t;
+
+uint16_t bandBuffer[BAND_HEIGHT*LCD_WIDTH];
+BandStats_t bandStats;
+
+/** Band flush function
+ *
+ * Render the scene band by band. bandRows (up to BAND_HEIGHT) lets the host compare band heights in one build.
+ *
+ */
+void bandFlush(bool full, uint8_t bandRows = BAND_HEIGHT){
+  for(int16_t y = 0; y < LCD_HEIGHT; y += bandRows){
+    int16_t rows = min(bandRows, LCD_HEIGHT - y);
+    int16_t x1 = 0;
+    int16_t x2 = LCD_WIDTH;
+
+    if(!full){ //Columns of the damage falling in this band
+      x1 = LCD_WIDTH;
+      x2 = 0;
+      for(uint8_t d = 0; d < compDamageCount; d++){
+        CompRect_t r = compDamage[d];
+        if((r.y >= y+rows) || (r.y+r.h <= y)){ continue; }
+        x1 = min(x1, r.x);
+        x2 = max(x2, r.x+r.w);
+      }
+      if(x1 >= x2){ continue; }
+    }
+
+    int16_t w = x2 - x1;
+    for(int16_t r = 0; r < rows; r++){ compositorRenderRow(y+r, x1, w, &bandBuffer[r*w]); }
+    for(int16_t r = 0; r < rows; ){ //Split where the band crosses the wrap of the scroll area (compositor.h)
+      int16_t n = compositorRun(y+r, y+rows);
+      int16_t m = compositorMemRow(y+r);
+      displayWindow(x1, m, x2-1, m+n-1);
+      displayPixels(&bandBuffer[r*w], (uint32_t)n*w);
+      r += n;
+    }
+
+    bandStats.bands++;
+    bandStats.pixels += (uint32_t)rows*w;
+  }
+  bandStats.frames++;
+}
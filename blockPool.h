@@ -0,0 +1,223 @@
+/**
+ * @file blockPool.h
+ *
+ * @brief Obstacle pool: structure-of-arrays storage, free-list allocation and a lane/row grid for broadphase queries
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/** Block Pool
+ *
+ * 1. Every field of a block lives in its own array, so a pass touches only the fields it needs
+ * 2. Free blocks are chained in a free list, active ones are kept packed in blockActive[] for the motion pass
+ * 3. Every active block is linked in the grid cell (lane, row) holding its top-left corner; cells are larger than
+ *    a block, so the blocks overlapping a rectangle are found in the cells it covers plus one lane and one row before
+ * 4. Collision and drawing query the grid and only touch blocks near the car or in the rows being rendered
+ * 5. Blocks fall with Q16.16 positions and velocities (fixedPoint.h); collision is swept along the rows crossed in the last step
+ *
+ */
+#ifndef BLOCK_POOL_SIZE
+#define BLOCK_POOL_SIZE 64 //Max blocks alive at the same time
+#endif
+#define BLOCK_SIZE 10 //Blocks are squares of BLOCK_SIZE pixels
+#define BLOCK_CELL 16 //Grid cell size, must not be smaller than BLOCK_SIZE
+#define BLOCK_LANES (LCD_WIDTH/BLOCK_CELL)
+#define BLOCK_ROWS (LCD_HEIGHT/BLOCK_CELL)
+#define BLOCK_NONE 0xFFFF
+
+typedef struct{
+  uint32_t queries; //Grid queries
+  uint32_t tested; //Blocks tested by the queries
+  uint32_t moves; //Blocks moved to another cell
+}BlockStats_t;
+
+/**
+ * Block fields
+ */
+uint8_t blockX[BLOCK_POOL_SIZE], blockY[BLOCK_POOL_SIZE]; //Position (pixels)
+q16_t blockFallY[BLOCK_POOL_SIZE]; //Exact vertical position, blockY is its integer part
+uint8_t blockDy[BLOCK_POOL_SIZE]; //Rows crossed in the last step
+uint8_t blockDrawnX[BLOCK_POOL_SIZE], blockDrawnY[BLOCK_POOL_SIZE]; //Position where the block is currently drawn on screen
+q16_t blockVel[BLOCK_POOL_SIZE]; //Falling velocity (pixels per step)
+uint8_t blockColour[BLOCK_POOL_SIZE]; //Palette index (colours.h)
+
+/**
+ * Pool bookkeeping
+ */
+uint16_t blockNext[BLOCK_POOL_SIZE], blockPrev[BLOCK_POOL_SIZE]; //Cell list links (blockNext also chains the free list)
+uint8_t blockCell[BLOCK_POOL_SIZE];
+uint16_t blockSlot[BLOCK_POOL_SIZE]; //Index in blockActive[]
+uint16_t blockActive[BLOCK_POOL_SIZE];
+uint16_t blockCount = 0; //Active blocks
+uint16_t blockFree = BLOCK_NONE; //Head of the free list
+uint16_t blockGrid[BLOCK_LANES*BLOCK_ROWS]; //Head of every cell list
+BlockStats_t blockStats;
+
+/** Grid helper functions
+ *
+ * blockCellOf --> cell holding the point (x, y), clamped to the grid
+ * blockLink/blockUnlink --> add/remove block i to/from the list of its cell
+ * blockRelink --> move block i to the list of the cell of its current position, if it changed
+ *
+ */
+uint8_t blockCellOf(int16_t x, int16_t y){
+  int16_t lane = constrain(x/BLOCK_CELL, 0, BLOCK_LANES-1);
+  int16_t row = constrain(y/BLOCK_CELL, 0, BLOCK_ROWS-1);
+  return row*BLOCK_LANES + lane;
+}
+
+void blockLink(uint16_t i){
+  uint8_t c = blockCellOf(blockX[i], blockY[i]);
+  blockCell[i] = c;
+  blockPrev[i] = BLOCK_NONE;
+  blockNext[i] = blockGrid[c];
+  if(blockGrid[c] != BLOCK_NONE){ blockPrev[blockGrid[c]] = i; }
+  blockGrid[c] = i;
+}
+
+void blockUnlink(uint16_t i){
+  if(blockPrev[i] != BLOCK_NONE){ blockNext[blockPrev[i]] = blockNext[i]; }
+  else{ blockGrid[blockCell[i]] = blockNext[i]; }
+  if(blockNext[i] != BLOCK_NONE){ blockPrev[blockNext[i]] = blockPrev[i]; }
+}
+
+void blockRelink(uint16_t i){
+  if(blockCellOf(blockX[i], blockY[i]) != blockCell[i]){
+    blockUnlink(i);
+    blockLink(i);
+    blockStats.moves++;
+  }
+}
+
+/** Pool functions
+ *
+ * 1. blockPoolReset --> free every block
+ * 2. blockAlloc --> take a block from the free list and place it (colour is a palette index), returns BLOCK_NONE when the pool is full
+ * 3. blockRelease --> give block i back to the free list
+ * 4. blockMove --> place block i at (x, y), relinking it only when it changes cell
+ * 5. blockFall --> advance block i by its velocity; returns false if it would reach row bottom, with its last step
+ *    ending at bottom so that blockSwept still sees the rows it crossed; the caller moves it back to the top
+ *
+ */
+void blockPoolReset(){
+  for(uint16_t i = 0; i < BLOCK_LANES*BLOCK_ROWS; i++){ blockGrid[i] = BLOCK_NONE; }
+  for(uint16_t i = 0; i < BLOCK_POOL_SIZE; i++){ blockNext[i] = (i+1 < BLOCK_POOL_SIZE) ? i+1 : BLOCK_NONE; }
+  blockFree = 0;
+  blockCount = 0;
+}
+
+uint16_t blockAlloc(uint8_t x, uint8_t y, q16_t vel, uint8_t colour){
+  uint16_t i = blockFree;
+  if(i == BLOCK_NONE){ return BLOCK_NONE; }
+  blockFree = blockNext[i];
+
+  blockX[i] = x; blockY[i] = y;
+  blockFallY[i] = Q16(y);
+  blockDy[i] = 0;
+  blockDrawnX[i] = x; blockDrawnY[i] = y;
+  blockVel[i] = vel;
+  blockColour[i] = colour;
+  blockLink(i);
+  blockSlot[i] = blockCount;
+  blockActive[blockCount++] = i;
+  return i;
+}
+
+void blockRelease(uint16_t i){
+  blockUnlink(i);
+  uint16_t last = blockActive[--blockCount]; //Keep blockActive[] packed
+  blockActive[blockSlot[i]] = last;
+  blockSlot[last] = blockSlot[i];
+  blockNext[i] = blockFree;
+  blockFree = i;
+}
+
+void blockMove(uint16_t i, uint8_t x, uint8_t y){
+  blockX[i] = x;
+  blockY[i] = y;
+  blockFallY[i] = Q16(y);
+  blockDy[i] = 0; //Placed, not swept
+  blockRelink(i);
+}
+
+bool blockFall(uint16_t i, int16_t bottom){
+  q16_t fall = blockFallY[i] + blockVel[i];
+  int16_t y = q16Floor(fall);
+  if(y >= bottom){ //Out of the screen: the last step ends at the bottom, so that it can still be swept
+    blockDy[i] = min(bottom - blockY[i], 255);
+    blockY[i] = bottom;
+    blockRelink(i);
+    return false;
+  }
+  blockFallY[i] = fall;
+  blockDy[i] = y - blockY[i];
+  blockY[i] = y;
+  blockRelink(i);
+  return true;
+}
+
+/** Query function
+ *
+ * Store in out (up to max) the blocks whose square touches the inclusive rectangle (x1, y1) - (x2, y2),
+ * edges included, and return how many were found
+ *
+ */
+uint16_t blockQuery(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t *out, uint16_t max){
+  uint16_t n = 0;
+  int16_t laneA = constrain((x1-BLOCK_SIZE)/BLOCK_CELL, 0, BLOCK_LANES-1), laneB = constrain(x2/BLOCK_CELL, 0, BLOCK_LANES-1);
+  int16_t rowA = constrain((y1-BLOCK_SIZE)/BLOCK_CELL, 0, BLOCK_ROWS-1), rowB = constrain(y2/BLOCK_CELL, 0, BLOCK_ROWS-1);
+  blockStats.queries++;
+
+  for(int16_t row = rowA; row <= rowB; row++){
+    for(int16_t lane = laneA; lane <= laneB; lane++){
+      for(uint16_t i = blockGrid[row*BLOCK_LANES + lane]; i != BLOCK_NONE; i = blockNext[i]){
+        blockStats.tested++;
+        if((blockY[i]+BLOCK_SIZE >= y1) && (blockY[i] <= y2) && (blockX[i]+BLOCK_SIZE >= x1) && (blockX[i] <= x2) && (n < max)){ out[n++] = i; }
+      }
+    }
+  }
+  return n;
+}
+
+/** Swept query functions
+ *
+ * 1. blockSwept --> true if a row crossed by block i in its last step touches the rectangle: from blockY-blockDy
+ *    to blockY+BLOCK_SIZE, so that a fast block cannot jump over it
+ * 2. blockSweep --> like blockQuery, with blockSwept as the test; maxDy bounds blockDy of every block. A block is
+ *    linked where its step ended, so the query reaches maxDy rows below the rectangle
+ *
+ */
+uint16_t blockSweepHits[BLOCK_POOL_SIZE];
+
+bool blockSwept(uint16_t i, int16_t x1, int16_t y1, int16_t x2, int16_t y2){
+  return (blockY[i]+BLOCK_SIZE >= y1) && (blockY[i]-blockDy[i] <= y2) && (blockX[i]+BLOCK_SIZE >= x1) && (blockX[i] <= x2);
+}
+
+uint16_t blockSweep(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t maxDy, uint16_t *out, uint16_t max){
+  uint16_t n = 0;
+  uint16_t found = blockQuery(x1, y1, x2, y2 + maxDy, blockSweepHits, BLOCK_POOL_SIZE);
+  for(uint16_t k = 0; k < found; k++){
+    uint16_t i = blockSweepHits[k];
+    if(blockSwept(i, x1, y1, x2, y2) && (n < max)){ out[n++] = i; }
+  }
+  return n;
+}
+
+/** Block layer function
+ *
+ * Compositor layer: paint the blocks crossing scene row row between columns x1 and x1+w-1
+ *
+ */
+uint16_t blockLayerHits[BLOCK_POOL_SIZE];
+
+void blockLayerRow(int16_t row, int16_t x1, int16_t w, uint16_t *out){
+  uint16_t n = blockQuery(x1, row, x1+w-1, row, blockLayerHits, BLOCK_POOL_SIZE);
+  for(uint16_t k = 0; k < n; k++){
+    uint16_t i = blockLayerHits[k];
+    if((row < blockY[i]) || (row >= blockY[i]+BLOCK_SIZE)){ continue; } //Query edges are inclusive
+    int16_t a = max((int16_t)blockX[i], x1);
+    int16_t b = min((int16_t)(blockX[i]+BLOCK_SIZE), (int16_t)(x1+w));
+    uint16_t colour = paletteColour(blockColour[i]);
+    for(int16_t x = a; x < b; x++){ out[x-x1] = colour; }
+  }
+}
@@ -0,0 +1,156 @@
+/**
+ * @file buttonEvents.h
+ *
+ * @brief Interrupt-driven buttons: debounced, timestamped press/release/long-press events in a lock-free queue
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/** Button Events
+ *
+ * 1. GPIO edge interrupt --> remember when the first edge happened and (re)start the debounce clock of the button
+ * 2. Debounce clock --> BUTTON_DEBOUNCE_MS after the last edge the pin is stable: if its level changed, push a press or release
+ * 3. Long press --> the same clock is rearmed after a press and pushes BUTTON_LONG if the button is still held
+ * 4. Consumer --> FSM states pop events with buttonEvent()/buttonPressed(), the edge-to-handling latency is accumulated;
+ *    every event pushed wakes loop() (wakeUp), so waiting states can sleep until it comes
+ *
+ * The queue has a single producer (the clock callbacks) and a single consumer (loop()): the producer only
+ * writes buttonHead and the consumer only writes buttonTail, so no lock is needed.
+ *
+ */
+#define NUM_BUTTONS 2
+#define BUTTON_S1 1 //Same values as triggeredButton
+#define BUTTON_S2 2
+#define BUTTON_DEBOUNCE_MS 10 //Time the pin must be stable after the last edge
+#define BUTTON_LONG_MS 800 //Hold time of a long press
+#define BUTTON_QUEUE 16 //Power of two
+
+typedef enum{
+  BUTTON_PRESS,
+  BUTTON_RELEASE,
+  BUTTON_LONG
+}ButtonEventType_t;
+
+typedef struct{
+  uint8_t button; //BUTTON_S1 or BUTTON_S2
+  uint8_t type; //ButtonEventType_t
+  uint32_t edge_us; //Time of the first edge (of the hold start for BUTTON_LONG)
+}ButtonEvent_t;
+
+typedef struct{
+  uint32_t events; //Events handled
+  uint32_t dropped; //Events lost because the queue was full
+  uint32_t edges; //Raw edges, bounces included
+  uint32_t max_latency_us; //Worst edge-to-handling time
+  uint64_t total_latency_us; //Sum of edge-to-handling times, used for the mean
+}ButtonStats_t;
+
+ButtonEvent_t buttonQueue[BUTTON_QUEUE];
+volatile uint8_t buttonHead = 0; //Next slot written by the producer
+volatile uint8_t buttonTail = 0; //Next slot read by the consumer
+ButtonStats_t buttonStats;
+
+uint8_t buttonPins[NUM_BUTTONS];
+Clock buttonClocks[NUM_BUTTONS];
+volatile bool buttonDown[NUM_BUTTONS]; //Debounced state
+volatile bool buttonSettling[NUM_BUTTONS]; //Edges seen, waiting for the pin to be stable
+volatile bool buttonHolding[NUM_BUTTONS]; //Press confirmed, long press not reported yet
+volatile uint32_t buttonEdgeUs[NUM_BUTTONS];
+
+/** Producer functions
+ *
+ * Run in interrupt and clock context only
+ *
+ */
+void buttonPush(uint8_t b, uint8_t type, uint32_t edge_us){
+  uint8_t head = buttonHead;
+  if((uint8_t)(head - buttonTail) == BUTTON_QUEUE){ buttonStats.dropped++; return; }
+  buttonQueue[head % BUTTON_QUEUE].button = b+1;
+  buttonQueue[head % BUTTON_QUEUE].type = type;
+  buttonQueue[head % BUTTON_QUEUE].edge_us = edge_us;
+  buttonHead = head+1; //Publish after the slot is written
+  wakeUp();
+}
+
+void buttonEdge(uint8_t b){
+  buttonStats.edges++;
+  if(!buttonSettling[b]){ buttonSettling[b] = true; buttonEdgeUs[b] = micros(); }
+  buttonClocks[b].setTimeout(BUTTON_DEBOUNCE_MS);
+  buttonClocks[b].start(); //Every bounce pushes the deadline further
+}
+
+void buttonSettle(uint8_t b){
+  bool pressed = (digitalRead(buttonPins[b]) == LOW);
+
+  if(buttonSettling[b]){
+    buttonSettling[b] = false;
+    if(pressed == buttonDown[b]){ return; } //Glitch: back to the previous level
+    buttonDown[b] = pressed;
+    buttonHolding[b] = pressed;
+    buttonPush(b, pressed ? BUTTON_PRESS : BUTTON_RELEASE, buttonEdgeUs[b]);
+    if(pressed){ //Come back when the press becomes a long one
+      buttonClocks[b].setTimeout(BUTTON_LONG_MS - BUTTON_DEBOUNCE_MS);
+      buttonClocks[b].start();
+    }
+  }
+  else if(buttonHolding[b] && pressed){
+    buttonHolding[b] = false;
+    buttonPush(b, BUTTON_LONG, buttonEdgeUs[b]);
+  }
+}
+
+void buttonOneEdge(){ buttonEdge(0); }
+void buttonTwoEdge(){ buttonEdge(1); }
+void buttonOneSettle(){ buttonSettle(0); }
+void buttonTwoSettle(){ buttonSettle(1); }
+
+/** Buttons begin function
+ *
+ * Setup pins (active LOW with pull-ups), edge interrupts and debounce clocks
+ *
+ */
+void buttonsBegin(uint8_t pinOne, uint8_t pinTwo){
+  buttonPins[0] = pinOne;
+  buttonPins[1] = pinTwo;
+  for(uint8_t b = 0; b < NUM_BUTTONS; b++){
+    pinMode(buttonPins[b], INPUT_PULLUP);
+    buttonDown[b] = (digitalRead(buttonPins[b]) == LOW);
+  }
+  buttonClocks[0].begin(buttonOneSettle, BUTTON_DEBOUNCE_MS, 0);
+  buttonClocks[1].begin(buttonTwoSettle, BUTTON_DEBOUNCE_MS, 0);
+  attachInterrupt(buttonPins[0], buttonOneEdge, CHANGE);
+  attachInterrupt(buttonPins[1], buttonTwoEdge, CHANGE);
+}
+
+/** Consumer functions
+ *
+ * 1. buttonEvent --> pop the oldest event, returns false if there is none
+ * 2. buttonPressed --> button of the oldest press (BUTTON_S1 or BUTTON_S2), 0 if none; other events are discarded
+ * 3. buttonFlush --> discard every pending event, used when a page must not react to earlier presses
+ *
+ */
+bool buttonEvent(ButtonEvent_t *e){
+  uint8_t tail = buttonTail;
+  if(tail == buttonHead){ return false; }
+  *e = buttonQueue[tail % BUTTON_QUEUE];
+  buttonTail = tail+1; //Release the slot after it is copied
+
+  uint32_t latency = micros() - e->edge_us;
+  if(e->type == BUTTON_LONG){ latency -= BUTTON_LONG_MS*1000UL; }
+  buttonStats.events++;
+  buttonStats.total_latency_us += latency;
+  if(latency > buttonStats.max_latency_us){ buttonStats.max_latency_us = latency; }
+  return true;
+}
+
+uint8_t buttonPressed(){
+  ButtonEvent_t e;
+  while(buttonEvent(&e)){
+    if(e.type == BUTTON_PRESS){ return e.button; }
+  }
+  return 0;
+}
+
+void buttonFlush(){
+  buttonTail = buttonHead;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file carSprites.h
+ *
+ * @brief Car artwork: one 20x22 sprite per team, body in the colour of the car chosen in the menu
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/**
+ * Sprite size: the body (carWidth) between two wheels (tyreDim) on each side, carLength rows
+ */
+#define CAR_SPRITE_W 20
+#define CAR_SPRITE_H 22
+#define CAR_SPRITES 3
+
+/**
+ * One letter per pixel, so that the tables read as the picture they hold (undefined at the end of the file)
+ */
+#define _ SPRITE_CLEAR
+#define B SPRITE_BODY
+#define W PAL_GREY //Wheels
+#define K PAL_BLACK
+#define H PAL_WHITE
+#define R PAL_RED
+#define Y PAL_YELLOW
+#define L PAL_BLUE
+
+/**
+ * Ferrari: yellow badge on the nose, yellow helmet, white number panel
+ */
+const uint8_t ferrariPixels[CAR_SPRITE_W*CAR_SPRITE_H] = {
+  _,_,_,B,B,B,B,B,B,B,B,B,B,B,B,B,B,_,_,_,
+  W,W,W,W,W,_,_,_,B,B,B,B,_,_,_,W,W,W,W,W,
+  W,W,W,W,W,_,_,_,B,B,B,B,_,_,_,W,W,W,W,W,
+  W,W,W,W,W,_,_,B,B,B,B,B,B,_,_,W,W,W,W,W,
+  W,W,W,W,W,_,_,B,B,Y,Y,B,B,_,_,W,W,W,W,W,
+  W,W,W,W,W,_,B,B,B,B,B,B,B,B,_,W,W,W,W,W,
+  _,_,_,_,_,B,B,B,B,B,B,B,B,B,B,_,_,_,_,_,
+  _,_,_,_,_,B,B,B,B,K,K,B,B,B,B,_,_,_,_,_,
+  _,_,_,_,_,B,B,B,K,Y,Y,K,B,B,B,_,_,_,_,_,
+  _,_,_,_,_,B,B,B,K,Y,Y,K,B,B,B,_,_,_,_,_,
+  _,_,_,_,_,B,B,B,B,K,K,B,B,B,B,_,_,_,_,_,
+  _,_,_,_,_,B,B,B,B,B,B,B,B,B,B,_,_,_,_,_,
+  _,_,_,_,B,B,B,B,H,H,H,H,B,B,B,B,_,_,_,_,
+  _,_,_,_,B,B,B,B,H,K,K,H,B,B,B,B,_,_,_,_,
+  _,_,_,_,B,B,B,B,H,H,H,H,B,B,B,B,_,_,_,_,
+  _,_,_,_,_,B,B,B,B,B,B,B,B,B,B,_,_,_,_,_,
+  W,W,W,W,W,B,B,B,B,B,B,B,B,B,B,W,W,W,W,W,
+  W,W,W,W,W,B,B,B,B,B,B,B,B,B,B,W,W,W,W,W,
+  W,W,W,W,W,B,B,B,B,B,B,B,B,B,B,W,W,W,W,W,
+  W,W,W,W,W,B,B,B,B,B,B,B,B,B,B,W,W,W,W,W,
+  W,W,W,W,W,B,B,B,B,B,B,B,B,B,B,W,W,W,W,W,
+  _,_,B,B,B,B,B,B,B,B,B,B,B,B,B,B,B,B,_,_
+};
+
+/**
+ * RedBull: yellow nose tip, red spine and sidepod stripes, red rear wing
+ */
+const uint8_t redBullPixels[CAR_SPRITE_W*CAR_SPRITE_H] = {
+  _,_,_,B,B,B,B,B,B,B,B,B,B,B,B,B,B,_,_,_,
+  W,W,W,W,W,_,_,_,Y,Y,Y,Y,_,_,_,W,W,W,W,W,
+  W,W,W,W,W,_,_,_,B,B,B,B,_,_,_,W,W,W,W,W,
+  W,W,W,W,W,_,_,B,B,B,B,B,B,_,_,W,W,W,W,W,
+  W,W,W,W,W,_,_,B,B,R,R,B,B,_,_,W,W,W,W,W,
+  W,W,W,W,W,_,B,B,B,R,R,B,B,B,_,W,W,W,W,W,
+  _,_,_,_,_,B,B,B,B,R,R,B,B,B,B,_,_,_,_,_,
+  _,_,_,_,_,B,B,B,B,K,K,B,B,B,B,_,_,_,_,_,
+  _,_,_,_,_,B,B,B,K,H,H,K,B,B,B,_,_,_,_,_,
+  _,_,_,_,_,B,B,B,K,H,H,K,B,B,B,_,_,_,_,_,
+  _,_,_,_,_,B,B,B,B,K,K,B,B,B,B,_,_,_,_,_,
+  _,_,_,_,R,B,B,B,B,B,B,B,B,B,B,R,_,_,_,_,
+  _,_,_,_,R,B,B,B,B,R,R,B,B,B,B,R,_,_,_,_,
+  _,_,_,_,R,B,B,B,B,R,R,B,B,B,B,R,_,_,_,_,
+  _,_,_,_,R,B,B,B,B,B,B,B,B,B,B,R,_,_,_,_,
+  _,_,_,_,_,B,B,B,B,Y,Y,B,B,B,B,_,_,_,_,_,
+  W,W,W,W,W,B,B,B,B,Y,Y,B,B,B,B,W,W,W,W,W,
+  W,W,W,W,W,B,B,B,B,B,B,B,B,B,B,W,W,W,W,W,
+  W,W,W,W,W,B,B,B,B,B,B,B,B,B,B,W,W,W,W,W,
+  W,W,W,W,W,B,B,B,B,B,B,B,B,B,B,W,W,W,W,W,
+  W,W,W,W,W,B,B,B,B,B,B,B,B,B,B,W,W,W,W,W,
+  _,_,R,R,R,R,R,R,R,R,R,R,R,R,R,R,R,R,_,_
+};
+
+/**
+ * McLaren: blue wing tips and helmet, black sidepods
+ */
+const uint8_t mcLarenPixels[CAR_SPRITE_W*CAR_SPRITE_H] = {
+  _,_,_,L,L,B,B,B,B,B,B,B,B,B,B,L,L,_,_,_,
+  W,W,W,W,W,_,_,_,B,B,B,B,_,_,_,W,W,W,W,W,
+  W,W,W,W,W,_,_,_,B,B,B,B,_,_,_,W,W,W,W,W,
+  W,W,W,W,W,_,_,B,B,B,B,B,B,_,_,W,W,W,W,W,
+  W,W,W,W,W,_,_,B,B,B,B,B,B,_,_,W,W,W,W,W,
+  W,W,W,W,W,_,B,B,B,B,B,B,B,B,_,W,W,W,W,W,
+  _,_,_,_,_,B,B,B,B,B,B,B,B,B,B,_,_,_,_,_,
+  _,_,_,_,_,B,B,B,B,K,K,B,B,B,B,_,_,_,_,_,
+  _,_,_,_,_,B,B,B,K,L,L,K,B,B,B,_,_,_,_,_,
+  _,_,_,_,_,B,B,B,K,L,L,K,B,B,B,_,_,_,_,_,
+  _,_,_,_,_,B,B,B,B,K,K,B,B,B,B,_,_,_,_,_,
+  _,_,_,_,K,B,B,B,B,B,B,B,B,B,B,K,_,_,_,_,
+  _,_,_,_,K,K,B,B,B,B,B,B,B,B,K,K,_,_,_,_,
+  _,_,_,_,K,K,B,B,B,B,B,B,B,B,K,K,_,_,_,_,
+  _,_,_,_,K,B,B,B,B,B,B,B,B,B,B,K,_,_,_,_,
+  _,_,_,_,_,B,B,B,B,B,B,B,B,B,B,_,_,_,_,_,
+  W,W,W,W,W,B,B,B,B,B,B,B,B,B,B,W,W,W,W,W,
+  W,W,W,W,W,B,B,B,B,B,B,B,B,B,B,W,W,W,W,W,
+  W,W,W,W,W,B,B,B,B,B,B,B,B,B,B,W,W,W,W,W,
+  W,W,W,W,W,B,B,B,B,B,B,B,B,B,B,W,W,W,W,W,
+  W,W,W,W,W,B,B,B,B,B,B,B,B,B,B,W,W,W,W,W,
+  _,_,L,L,B,B,B,B,B,B,B,B,B,B,B,B,L,L,_,_
+};
+
+#undef _
+#undef B
+#undef W
+#undef K
+#undef H
+#undef R
+#undef Y
+#undef L
+
+/**
+ * Sprites in the order of the car menu
+ */
+const Sprite_t carSprites[CAR_SPRITES] = {
+  {CAR_SPRITE_W, CAR_SPRITE_H, ferrariPixels},
+  {CAR_SPRITE_W, CAR_SPRITE_H, redBullPixels},
+  {CAR_SPRITE_W, CAR_SPRITE_H, mcLarenPixels}
+};
@@ -0,0 +1,99 @@
+/**
+ * @file colours.h
+ *
+ * @brief Colours used to draw on the screen: RGB565 palette computed at compile time and kept in flash
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/** Palette
+ *
+ * 1. rgb565 --> same conversion as calculateColour(), evaluated by the compiler
+ * 2. palette[] --> every colour of the game, indexed by PaletteIndex_t; a constant index folds into an immediate,
+ *    a variable one is a single halfword load from flash
+ * 3. Named colours --> palette entries, so no use site calls calculateColour() at run time; the library ones that
+ *    the game redefines (yellow, cyan, orange, magenta, violet) are replaced by the same values
+ * 4. Tables that pick colours at run time (blocks, sprites) store 1-byte palette indices and read them with paletteColour()
+ *
+ */
+constexpr uint16_t rgb565(uint8_t red, uint8_t green, uint8_t blue){
+  return ((red >> 3) << 11) | ((green >> 2) << 5) | (blue >> 3);
+}
+
+typedef enum{
+  PAL_BLACK,
+  PAL_WHITE,
+  PAL_RED,
+  PAL_GREEN,
+  PAL_BLUE,
+  PAL_GREY,
+  PAL_ORANGE,
+  PAL_CYAN,
+  PAL_MAGENTA,
+  PAL_VIOLET,
+  PAL_PINK,
+  PAL_YELLOW,
+  PAL_SPRING_GREEN,
+  PAL_DEEP_PINK,
+  PAL_TURQUOISE,
+  PAL_DARK_GREEN,
+  PAL_PEACH_PUFF,
+  PAL_COLOURS
+}PaletteIndex_t;
+
+constexpr uint16_t palette[PAL_COLOURS] = {
+  rgb565(0, 0, 0), //Black
+  rgb565(255, 255, 255), //White
+  rgb565(255, 0, 0), //Red
+  rgb565(0, 255, 0), //Green
+  rgb565(0, 0, 255), //Blue
+  rgb565(128, 128, 128), //Grey
+  rgb565(255, 128, 0), //Orange
+  rgb565(0, 255, 255), //Cyan
+  rgb565(255, 0, 255), //Magenta
+  rgb565(138, 43, 226), //Violet
+  rgb565(245, 185, 185), //Pink
+  rgb565(255, 255, 0), //Yellow
+  rgb565(0, 255, 127), //Spring green
+  rgb565(255, 20, 147), //Deep pink
+  rgb565(0, 206, 209), //Turquoise
+  rgb565(0, 100, 0), //Dark green
+  rgb565(255, 218, 155) //Peach puff
+};
+
+static_assert(palette[PAL_BLACK] == blackColour, "palette black differs from the LCD_screen one");
+static_assert(palette[PAL_WHITE] == whiteColour, "palette white differs from the LCD_screen one");
+static_assert(palette[PAL_RED] == redColour, "palette red differs from the LCD_screen one");
+static_assert(palette[PAL_GREEN] == greenColour, "palette green differs from the LCD_screen one");
+static_assert(palette[PAL_BLUE] == blueColour, "palette blue differs from the LCD_screen one");
+
+/** Palette function
+ *
+ * Colour of palette index i (any value, wrapped to the palette)
+ *
+ */
+uint16_t paletteColour(uint8_t i){
+  return palette[i % PAL_COLOURS];
+}
+
+/**
+ * Definition of colors used to draw on the screen
+ */
+#undef greyColour
+#undef orangeColour
+#undef cyanColour
+#undef magentaColour
+#undef violetColour
+#undef yellowColour
+#define greyColour palette[PAL_GREY]
+#define orangeColour palette[PAL_ORANGE]
+#define cyanColour palette[PAL_CYAN]
+#define magentaColour palette[PAL_MAGENTA]
+#define violetColour palette[PAL_VIOLET]
+#define pinkColour palette[PAL_PINK]
+#define yellowColour palette[PAL_YELLOW]
+#define springGreen palette[PAL_SPRING_GREEN]
+#define deepPinkColour palette[PAL_DEEP_PINK]
+#define turquoiseColour palette[PAL_TURQUOISE]
+#define darkGreenColour palette[PAL_DARK_GREEN]
+#define peachPuffColour palette[PAL_PEACH_PUFF]
@@ -0,0 +1,303 @@
+/**
+ * @file compositor.h
+ *
+ * @brief Damage-tracking compositor: collects the regions changed in a frame, merges them and redraws each one with a single window
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/** Compositor Usage
+ *
+ * 1. compositorBegin --> start a new frame
+ * 2. compositorObject --> add the scene as solid rectangles, in draw order (road and grass, blocks, car on top)
+ *    compositorLayer --> add, in the same order, a function painting a whole family of objects (e.g. the block pool)
+ *    compositorSprite --> add, in the same order, a sprite (sprites.h) with its body colour
+ * 3. compositorText --> add transparent text drawn above every rectangle (HUD)
+ * 4. compositorDamage --> mark the regions that changed (old and new position of every moved object)
+ *    compositorDamageMove --> mark a moved object: one region covering both positions, unless it is a long jump
+ * 5. compositorFlush --> merge overlapping and adjacent damage, then for each merged region render the scene
+ *    row by row and push it to the display with one address window (queued when displayQueue.h is on)
+ *
+ * Every pixel of a flushed region is computed from the scene, so regions can be merged freely:
+ * nothing that was on screen is lost, only the pixels outside the damage are left untouched.
+ *
+ * Scrolling (optional):
+ * 1. compositorScrollArea --> make rows top..top+height-1 the panel scroll area (hal.h), height 0 for none
+ * 2. compositorScroll --> at the start of the draw, move everything in the area down by dy rows with one command
+ *    and damage the dy rows exposed at its top. What moves with the scene (road, blocks) is then already in place;
+ *    what stays put on screen (car) must damage where its image was carried to as well as where it is
+ * 3. Scene and damage stay in screen coordinates: the flush maps rows to memory rows and splits windows at the wrap
+ * 4. compositorScrollEnd --> back to memory row = screen row, redrawing the area, before anything else draws on it
+ *
+ */
+#define COMP_MAX_OBJECTS 24 //Max rectangles describing the scene
+#define COMP_MAX_DAMAGE 24 //Max damaged regions per frame
+#define COMP_MAX_TEXTS 4 //Max text items in the scene
+#define COMP_WINDOW_PX 6 //A window setup costs as many bytes as ~6 pixels
+
+/**
+ * Compositor types definition
+ */
+typedef struct{
+  int16_t x, y, w, h;
+}CompRect_t;
+
+typedef void (*CompLayer_t)(int16_t row, int16_t x1, int16_t w, uint16_t *out); //Paint row between x1 and x1+w-1
+
+typedef struct{
+  CompRect_t r;
+  uint16_t colour; //Body colour of a sprite
+  CompLayer_t layer; //NULL for a solid rectangle
+  const Sprite_t *sprite; //NULL for a solid rectangle
+  int16_t sx, sy; //Top-left corner of the sprite, r is clipped to the screen
+}CompObject_t;
+
+typedef struct{
+  int16_t x, y;
+  const char *text; //Must stay valid until the frame is flushed
+  uint16_t colour;
+}CompText_t;
+
+typedef struct{
+  uint32_t frames; //Frames flushed
+  uint32_t damaged; //Regions marked as damaged
+  uint32_t windows; //Windows actually pushed after merging
+  uint32_t pixels; //Pixels pushed
+  uint32_t scrolled; //Rows moved by the panel scroll
+}CompositorStats_t;
+
+typedef struct{
+  int16_t top, height; //Scroll area rows, height 0 when there is none
+  int16_t offset; //Memory row shown at the top of the area, relative to top
+}CompScroll_t;
+
+CompObject_t compObjects[COMP_MAX_OBJECTS];
+uint8_t compObjectCount = 0;
+CompText_t compTexts[COMP_MAX_TEXTS];
+uint8_t compTextCount = 0;
+CompRect_t compDamage[COMP_MAX_DAMAGE];
+uint8_t compDamageCount = 0;
+uint16_t compLine[LCD_WIDTH];
+CompositorStats_t compStats;
+CompScroll_t compScroll = {0, 0, 0};
+
+/** Rectangle helper functions
+ *
+ * compClip --> intersect r with the screen, returns false when nothing is left
+ * compUnion --> bounding box of a and b
+ *
+ */
+bool compClip(CompRect_t *r){
+  if(r->x < 0){ r->w += r->x; r->x = 0; }
+  if(r->y < 0){ r->h += r->y; r->y = 0; }
+  if(r->x + r->w > LCD_WIDTH){ r->w = LCD_WIDTH - r->x; }
+  if(r->y + r->h > LCD_HEIGHT){ r->h = LCD_HEIGHT - r->y; }
+  return (r->w > 0) && (r->h > 0);
+}
+
+CompRect_t compUnion(CompRect_t a, CompRect_t b){
+  CompRect_t u;
+  u.x = min(a.x, b.x);
+  u.y = min(a.y, b.y);
+  u.w = max(a.x+a.w, b.x+b.w) - u.x;
+  u.h = max(a.y+a.h, b.y+b.h) - u.y;
+  return u;
+}
+
+/** Frame building functions
+ *
+ * Add scene rectangles and damaged regions for the current frame
+ *
+ */
+void compositorBegin(){
+  compObjectCount = 0;
+  compTextCount = 0;
+  compDamageCount = 0;
+}
+
+void compositorObject(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t colour){
+  if(compObjectCount >= COMP_MAX_OBJECTS){ return; }
+  CompObject_t *o = &compObjects[compObjectCount];
+  o->r.x = x; o->r.y = y; o->r.w = w; o->r.h = h;
+  o->colour = colour;
+  o->layer = NULL;
+  o->sprite = NULL;
+  if(compClip(&o->r)){ compObjectCount++; }
+}
+
+void compositorSprite(int16_t x, int16_t y, const Sprite_t *sprite, uint16_t body){
+  if(compObjectCount >= COMP_MAX_OBJECTS){ return; }
+  CompObject_t *o = &compObjects[compObjectCount];
+  o->r.x = x; o->r.y = y; o->r.w = sprite->w; o->r.h = sprite->h;
+  o->colour = body;
+  o->layer = NULL;
+  o->sprite = sprite;
+  o->sx = x; o->sy = y;
+  if(compClip(&o->r)){ compObjectCount++; }
+}
+
+void compositorLayer(CompLayer_t layer){
+  if(compObjectCount >= COMP_MAX_OBJECTS){ return; }
+  CompObject_t *o = &compObjects[compObjectCount++];
+  o->r.x = 0; o->r.y = 0; o->r.w = LCD_WIDTH; o->r.h = LCD_HEIGHT;
+  o->layer = layer;
+  o->sprite = NULL;
+}
+
+void compositorText(int16_t x, int16_t y, const char *text, uint16_t colour){
+  if(compTextCount >= COMP_MAX_TEXTS){ return; }
+  CompText_t *t = &compTexts[compTextCount++];
+  t->x = x; t->y = y; t->text = text; t->colour = colour;
+}
+
+void compositorDamage(int16_t x, int16_t y, int16_t w, int16_t h){
+  CompRect_t r = {x, y, w, h};
+  if(!compClip(&r)){ return; }
+  compStats.damaged++;
+  if(compDamageCount >= COMP_MAX_DAMAGE){ //No room left: grow the last region
+    compDamage[COMP_MAX_DAMAGE-1] = compUnion(compDamage[COMP_MAX_DAMAGE-1], r);
+    return;
+  }
+  compDamage[compDamageCount++] = r;
+}
+
+void compositorDamageMove(CompRect_t from, CompRect_t to){
+  CompRect_t u = compUnion(from, to);
+  if((int32_t)u.w*u.h <= (int32_t)from.w*from.h + (int32_t)to.w*to.h + COMP_WINDOW_PX){ //Small step: one window, no pixel written twice
+    compositorDamage(u.x, u.y, u.w, u.h);
+    return;
+  }
+  compositorDamage(from.x, from.y, from.w, from.h); //Long jump: the corners of the union would cost more than a second window
+  compositorDamage(to.x, to.y, to.w, to.h);
+}
+
+/** Scroll functions
+ *
+ * 1. compositorScrollArea, compositorScroll, compositorScrollEnd --> see Compositor Usage
+ * 2. compositorMemRow --> memory row holding screen row y
+ * 3. compositorRun --> rows from y (before end) that lie in consecutive memory rows, so one window holds them
+ *
+ */
+void compositorScrollArea(int16_t top, int16_t height){
+  compScroll.top = top;
+  compScroll.height = height;
+  compScroll.offset = 0;
+  lcdScrollArea(top, height);
+  lcdScrollStart(top);
+}
+
+void compositorScroll(int16_t dy){
+  if((dy <= 0) || (compScroll.height == 0)){ return; }
+  dy = min(dy, compScroll.height);
+  compScroll.offset = (compScroll.offset - dy + compScroll.height) % compScroll.height;
+  displayScrollStart(compScroll.top + compScroll.offset);
+  compositorDamage(0, compScroll.top, LCD_WIDTH, dy); //Rows carried round from the bottom of the area
+  compStats.scrolled += dy;
+}
+
+int16_t compositorMemRow(int16_t y){
+  if((y < compScroll.top) || (y >= compScroll.top + compScroll.height)){ return y; }
+  return compScroll.top + (y - compScroll.top + compScroll.offset) % compScroll.height;
+}
+
+int16_t compositorRun(int16_t y, int16_t end){
+  if(y < compScroll.top){ return min(end, compScroll.top) - y; }
+  if(y >= compScroll.top + compScroll.height){ return end - y; }
+  int16_t wrap = y + compScroll.height - (y - compScroll.top + compScroll.offset) % compScroll.height; //First row after the wrap
+  return min(end, wrap) - y;
+}
+
+/** Merge function
+ *
+ * Repeatedly replace two regions by their bounding box when pushing it costs no more than pushing both:
+ * overlapping and adjacent regions merge, distant ones stay apart
+ *
+ */
+void compositorMerge(){
+  bool merged = true;
+  while(merged){
+    merged = false;
+    for(uint8_t i = 0; i < compDamageCount && !merged; i++){
+      for(uint8_t j = i+1; j < compDamageCount && !merged; j++){
+        CompRect_t a = compDamage[i];
+        CompRect_t b = compDamage[j];
+        CompRect_t u = compUnion(a, b);
+        if((int32_t)u.w*u.h <= (int32_t)a.w*a.h + (int32_t)b.w*b.h + COMP_WINDOW_PX){
+          compDamage[i] = u;
+          compDamage[j] = compDamage[--compDamageCount];
+          merged = true;
+        }
+      }
+    }
+  }
+}
+
+/** Render row function
+ *
+ * Compute the w pixels of scene row row starting at column x1: black road, then every rectangle,
+ * layer and sprite in draw order, then the font dots of every text
+ *
+ */
+void compositorRenderRow(int16_t row, int16_t x1, int16_t w, uint16_t *out){
+  for(int16_t i = 0; i < w; i++){ out[i] = blackColour; }
+
+  for(uint8_t k = 0; k < compObjectCount; k++){
+    CompRect_t o = compObjects[k].r;
+    if((row < o.y) || (row >= o.y+o.h)){ continue; }
+    if(compObjects[k].layer != NULL){ compObjects[k].layer(row, x1, w, out); continue; }
+    if(compObjects[k].sprite != NULL){ spritePaintRow(compObjects[k].sprite, compObjects[k].sx, row - compObjects[k].sy, compObjects[k].colour, x1, w, out); continue; }
+    int16_t a = max(o.x, x1);
+    int16_t b = min(o.x+o.w, x1+w);
+    for(int16_t i = a; i < b; i++){ out[i-x1] = compObjects[k].colour; }
+  }
+
+  for(uint8_t k = 0; k < compTextCount; k++){
+    CompText_t *t = &compTexts[k];
+    int16_t j = row - t->y;
+    if((j < 0) || (j >= FONT_HEIGHT)){ continue; }
+    for(int16_t c = 0; t->text[c] != 0; c++){
+      char ch = t->text[c];
+      if((ch < FONT_FIRST) || (ch > FONT_LAST)){ continue; }
+      for(int16_t i = 0; i < 5; i++){
+        int16_t px = t->x + c*FONT_WIDTH + i;
+        if((px >= x1) && (px < x1+w) && ((font5x7[ch-FONT_FIRST][i] >> j) & 0x01)){ out[px-x1] = t->colour; }
+      }
+    }
+  }
+}
+
+/** Flush function
+ *
+ * Render every merged region row by row (later objects cover earlier ones) and push it in one window
+ *
+ */
+void compositorFlush(){
+  compositorMerge();
+
+  for(uint8_t d = 0; d < compDamageCount; d++){
+    CompRect_t r = compDamage[d];
+    for(int16_t y = r.y; y < r.y+r.h; ){ //One window, or two when the region crosses the wrap of the scroll area
+      int16_t n = compositorRun(y, r.y+r.h);
+      int16_t m = compositorMemRow(y);
+      displayWindow(r.x, m, r.x+r.w-1, m+n-1);
+
+      for(int16_t row = y; row < y+n; row++){
+        compositorRenderRow(row, r.x, r.w, compLine);
+        displayPixels(compLine, r.w);
+      }
+      compStats.windows++;
+      y += n;
+    }
+    compStats.pixels += (uint32_t)r.w*r.h;
+  }
+  compStats.frames++;
+}
+
+void compositorScrollEnd(){
+  if(compScroll.height == 0){ return; }
+  compScroll.offset = 0;
+  displayScrollStart(compScroll.top);
+  compDamageCount = 0;
+  compositorDamage(0, compScroll.top, LCD_WIDTH, compScroll.height);
+  compositorFlush();
+}
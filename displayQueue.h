@@ -0,0 +1,225 @@
+/**
+ * @file displayQueue.h
+ *
+ * @brief Asynchronous display: draw commands queued in two buffers, one filled by the CPU while the DMA drains the other
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/** Display Queue
+ *
+ * 1. displayWindow, displayPixels, displayScrollStart --> the display bus calls of the compositor and the band renderer:
+ *    sent right away (hal.h) unless the queue is on, in which case they are appended to the queue being filled
+ * 2. Commands are stored as they go on the wire: pixels in bus byte order, consecutive pixel pushes merged into one,
+ *    so a window of any height is one command and one DMA transfer
+ * 3. displaySubmit --> end of frame: hand the filled queue to the DMA engine and fill the other one. It returns a fence,
+ *    and waits only if the other queue is still being drained, i.e. when the bus is a whole frame behind
+ * 4. displayDone, displayWait --> test or wait for a fence: the CPU waits only before touching what the queue draws.
+ *    displayDoneAt --> when a fence completed, for the last DISPLAY_FENCE_TIMES fences
+ * 5. The engine runs in the DMA interrupt: commands and window parameters are clocked by the CPU (a few bytes),
+ *    pixels by the DMA. A frame larger than a queue is submitted in parts (overflows)
+ * 6. displayBegin --> once at boot: set up the DMA channel
+ * 7. displayAsync --> turn the queue on or off; off waits for everything queued, so the blocking calls of the
+ *    other pages never interleave with a transfer
+ *
+ */
+#ifndef DISPLAY_QUEUE_BYTES
+#define DISPLAY_QUEUE_BYTES 4096 //Per queue: two of them
+#endif
+#define DISPLAY_FENCE_TIMES 8 //Completion times kept
+
+typedef enum{
+  DQ_WINDOW, //x1, y1, x2, y2
+  DQ_PIXELS, //Count (2 bytes), then 2 bytes per pixel, high byte first
+  DQ_SCROLL //Row
+}DisplayCommand_t;
+
+typedef struct{
+  uint8_t bytes[DISPLAY_QUEUE_BYTES];
+  uint16_t used;
+  uint16_t pixels; //Offset of the last DQ_PIXELS command when it ends the queue, 0xFFFF otherwise
+  uint32_t fence; //Sequence number given by displaySubmit
+}DisplayQueue_t;
+
+typedef struct{
+  uint32_t submits; //Queues handed to the DMA
+  uint32_t overflows; //Submits forced by a full queue
+  uint16_t maxBytes; //Largest queue submitted
+  uint32_t transfers; //DMA transfers
+  uint32_t waits; //Submits and waits that found the DMA still busy
+  uint32_t waitUs; //Time the CPU spent waiting for the DMA
+}DisplayQueueStats_t;
+
+DisplayQueue_t displayQueues[2];
+uint8_t displayFill = 0; //Queue being filled
+volatile uint8_t displayDrain = 0; //Queue being drained
+volatile uint16_t displayPos = 0; //Next command of the drained queue
+volatile bool displayBusy = false;
+volatile uint32_t displayDoneFence = 0; //Last fence completed
+volatile uint32_t displayDoneUs[DISPLAY_FENCE_TIMES]; //Completion time of the last fences, indexed by fence
+uint32_t displayFence = 0; //Last fence given
+bool displayQueued = false; //The queue is on
+DisplayQueueStats_t displayStats;
+
+/** Engine function
+ *
+ * Send the next commands of the drained queue, up to the next pixels (started on the DMA) or the end of the queue.
+ * Runs in the DMA interrupt, and from displaySubmit for the first command.
+ *
+ */
+void displayEngine(){
+  DisplayQueue_t *q = &displayQueues[displayDrain];
+  while(displayPos < q->used){
+    uint8_t *c = &q->bytes[displayPos];
+    if(c[0] == DQ_WINDOW){
+      uint8_t cols[4] = {0, c[1], 0, c[3]};
+      uint8_t rows[4] = {0, c[2], 0, c[4]};
+      lcdDmaCommand(LCD_CASET, cols, 4);
+      lcdDmaCommand(LCD_RASET, rows, 4);
+      lcdDmaCommand(LCD_RAMWR, NULL, 0);
+      displayPos += 5;
+    }
+    else if(c[0] == DQ_SCROLL){
+      uint8_t row[2] = {0, c[1]};
+      lcdDmaCommand(LCD_VSCSAD, row, 2);
+      displayPos += 2;
+    }
+    else{
+      uint16_t n = c[1] | (c[2] << 8);
+      displayPos += 3 + 2*n;
+      displayStats.transfers++;
+      lcdDmaData(&c[3], 2*n);
+      return;
+    }
+  }
+  displayBusy = false;
+  displayDoneUs[q->fence % DISPLAY_FENCE_TIMES] = micros();
+  displayDoneFence = q->fence;
+}
+
+/** Fence functions
+ *
+ * 1. displayDone --> true when everything submitted up to fence has reached the panel
+ * 2. displayWait --> sleep until then
+ * 3. displayDoneAt --> micros() when fence completed, valid while it is done and one of the last DISPLAY_FENCE_TIMES
+ *
+ */
+bool displayDone(uint32_t fence){
+  return (int32_t)(displayDoneFence - fence) >= 0;
+}
+
+uint32_t displayDoneAt(uint32_t fence){
+  return displayDoneUs[fence % DISPLAY_FENCE_TIMES];
+}
+
+void displayWait(uint32_t fence){
+  if(displayDone(fence)){ return; }
+  uint32_t start = micros();
+  displayStats.waits++;
+  while(!displayDone(fence)){ lcdDmaWait(); }
+  displayStats.waitUs += micros() - start;
+}
+
+/** Submit function
+ *
+ * Hand the queue being filled to the engine and return its fence (the last one when it is empty)
+ *
+ */
+uint32_t displaySubmit(){
+  DisplayQueue_t *q = &displayQueues[displayFill];
+  if(!displayQueued || (q->used == 0)){ return displayFence; }
+  displayWait(displayFence); //The other queue: one frame in flight at most
+  q->fence = ++displayFence;
+  displayStats.submits++;
+  displayStats.maxBytes = max(displayStats.maxBytes, q->used);
+
+  noInterrupts();
+  displayDrain = displayFill;
+  displayPos = 0;
+  displayBusy = true;
+  displayEngine();
+  interrupts();
+
+  displayFill ^= 1;
+  displayQueues[displayFill].used = 0;
+  displayQueues[displayFill].pixels = 0xFFFF;
+  return q->fence;
+}
+
+/** Queue functions
+ *
+ * 1. displayReserve --> room for n bytes in the queue being filled, submitting it first when it is full
+ * 2. displayBegin, displayAsync --> see Display Queue
+ * 3. displayWindow, displayPixels, displayScrollStart --> queued or immediate bus calls (see Display Queue)
+ *
+ */
+uint8_t *displayReserve(uint16_t n){
+  DisplayQueue_t *q = &displayQueues[displayFill];
+  if(q->used + n > DISPLAY_QUEUE_BYTES){
+    displayStats.overflows++;
+    displaySubmit();
+    q = &displayQueues[displayFill];
+  }
+  uint8_t *p = &q->bytes[q->used];
+  q->used += n;
+  return p;
+}
+
+void displayBegin(){
+  lcdDmaBegin(displayEngine);
+}
+
+void displayAsync(bool on){
+  if(on == displayQueued){ return; }
+  if(!on){
+    displaySubmit();
+    displayWait(displayFence);
+  }
+  else{
+    displayQueues[displayFill].used = 0;
+    displayQueues[displayFill].pixels = 0xFFFF;
+  }
+  displayQueued = on;
+}
+
+void displayWindow(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2){
+  if(!displayQueued){ lcdWindow(x1, y1, x2, y2); return; }
+  uint8_t *p = displayReserve(5);
+  p[0] = DQ_WINDOW; p[1] = x1; p[2] = y1; p[3] = x2; p[4] = y2;
+  displayQueues[displayFill].pixels = 0xFFFF;
+}
+
+void displayScrollStart(uint8_t row){
+  if(!displayQueued){ lcdScrollStart(row); return; }
+  uint8_t *p = displayReserve(2);
+  p[0] = DQ_SCROLL; p[1] = row;
+  displayQueues[displayFill].pixels = 0xFFFF;
+}
+
+void displayPixels(const uint16_t *pixels, uint32_t n){
+  if(!displayQueued){ lcdPushPixels(pixels, n); return; }
+  while(n > 0){
+    DisplayQueue_t *q = &displayQueues[displayFill];
+    uint16_t k;
+    uint8_t *p;
+    if((q->pixels != 0xFFFF) && (q->used + 2 <= DISPLAY_QUEUE_BYTES)){ //Extend the pixels ending the queue
+      k = min(n, (uint32_t)(DISPLAY_QUEUE_BYTES - q->used)/2);
+      uint8_t *c = &q->bytes[q->pixels];
+      uint16_t total = (c[1] | (c[2] << 8)) + k;
+      c[1] = lowByte(total); c[2] = highByte(total);
+      p = &q->bytes[q->used];
+      q->used += 2*k;
+    }
+    else{
+      if(q->used + 5 > DISPLAY_QUEUE_BYTES){ displayStats.overflows++; displaySubmit(); q = &displayQueues[displayFill]; }
+      k = min(n, (uint32_t)(DISPLAY_QUEUE_BYTES - q->used - 3)/2);
+      q->pixels = q->used;
+      uint8_t *c = displayReserve(3 + 2*k);
+      c[0] = DQ_PIXELS; c[1] = lowByte(k); c[2] = highByte(k);
+      p = c + 3;
+    }
+    for(uint16_t i = 0; i < k; i++){ *p++ = highByte(pixels[i]); *p++ = lowByte(pixels[i]); }
+    pixels += k;
+    n -= k;
+  }
+}
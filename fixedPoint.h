@@ -0,0 +1,39 @@
+/**
+ * @file fixedPoint.h
+ *
+ * @brief Q16.16 fixed-point numbers for sub-pixel motion, integer-only
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/** Q16.16
+ *
+ * A q16_t holds value*65536 in a signed 32-bit integer: 16 integer bits (sign included) and 16 fraction bits.
+ * Sums are plain integer sums; products go through a 64-bit intermediate, a single UMULL/SMULL on the Cortex-M4.
+ *
+ */
+typedef int32_t q16_t;
+
+#define Q16_SHIFT 16
+#define Q16_ONE ((q16_t)1 << Q16_SHIFT)
+#define Q16(n) ((q16_t)(n) << Q16_SHIFT) //Integer to Q16.16
+#define Q16_FRAC(num, den) ((q16_t)(((int64_t)(num) << Q16_SHIFT)/(den))) //num/den, for constants
+
+/** Q16.16 functions
+ *
+ * 1. q16Floor --> integer part, rounded towards minus infinity
+ * 2. q16Ceil --> smallest integer not below q
+ * 3. q16Mul --> product of two Q16.16 numbers
+ *
+ */
+int32_t q16Floor(q16_t q){
+  return q >> Q16_SHIFT;
+}
+
+int32_t q16Ceil(q16_t q){
+  return (q + Q16_ONE - 1) >> Q16_SHIFT;
+}
+
+q16_t q16Mul(q16_t a, q16_t b){
+  return (q16_t)(((int64_t)a*b) >> Q16_SHIFT);
+}
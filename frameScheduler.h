@@ -0,0 +1,83 @@
+/**
+ * @file frameScheduler.h
+ *
+ * @brief Fixed-timestep frame scheduler driven by the monotonic micros() tick
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/**
+ * Scheduler constants definition
+ */
+#ifndef FRAME_RATE_HZ
+#define FRAME_RATE_HZ 30 //Game frame rate (20, 30 or 60)
+#endif
+#define FRAME_PERIOD_US (1000000UL/FRAME_RATE_HZ) //Frame budget
+#define MAX_CATCHUP_STEPS 4 //Max simulation steps run in a single frame after an overrun
+
+/**
+ * Scheduler state and frame statistics
+ */
+typedef struct{
+  uint32_t next_us; //Deadline of the next simulation step
+  uint32_t frame_start_us; //Start time of the current frame
+  uint32_t frames; //Frames rendered
+  uint32_t steps; //Simulation steps run
+  uint32_t overruns; //Frames whose work exceeded the budget
+  uint32_t dropped; //Steps dropped because the backlog was larger than MAX_CATCHUP_STEPS
+  uint32_t work_us; //Work time of the last frame
+  uint32_t max_work_us; //Worst work time
+  uint64_t total_work_us; //Sum of work times, used for the mean
+}FrameScheduler_t;
+
+/** Start scheduler function
+ *
+ * Reset statistics and make the first step due immediately
+ *
+ */
+void frameSchedulerStart(FrameScheduler_t *fs){
+  memset(fs, 0, sizeof(FrameScheduler_t));
+  fs->next_us = micros();
+}
+
+/** Frame steps function
+ *
+ * Called at the beginning of a frame, returns how many fixed simulation steps are due.
+ * After an overrun more than one step is returned so that the game speed does not depend on the draw load.
+ *
+ */
+uint8_t frameSchedulerSteps(FrameScheduler_t *fs){
+  uint8_t n = 0;
+  fs->frame_start_us = micros();
+
+  while(((int32_t)(fs->frame_start_us - fs->next_us) >= 0) && (n < MAX_CATCHUP_STEPS)){
+    fs->next_us += FRAME_PERIOD_US;
+    n++;
+  }
+  while((int32_t)(fs->frame_start_us - fs->next_us) >= 0){ //Backlog too long: drop it
+    fs->next_us += FRAME_PERIOD_US;
+    fs->dropped++;
+  }
+
+  fs->steps += n;
+  return n;
+}
+
+/** Frame wait function
+ *
+ * Called at the end of a frame: measure the work done and sleep only for what is left of the budget.
+ * The sleep is rounded up to whole RTOS ticks, so the CPU stays in low-power mode for all of it instead of
+ * busy-waiting the last fraction of a millisecond; the frame may start up to a tick late, the steps keep their phase.
+ *
+ */
+void frameSchedulerWait(FrameScheduler_t *fs){
+  uint32_t now = micros();
+  fs->work_us = now - fs->frame_start_us;
+  fs->total_work_us += fs->work_us;
+  if(fs->work_us > fs->max_work_us){ fs->max_work_us = fs->work_us; }
+  fs->frames++;
+
+  int32_t remaining = (int32_t)(fs->next_us - now);
+  if(remaining <= 0){ fs->overruns++; return; }
+  delay((remaining + 999)/1000);
+}
@@ -0,0 +1,397 @@
+/**
+ * @file hal.h
+ *
+ * @brief Hardware abstraction layer: binds the game either to the LaunchPad drivers or to the Linux host mocks
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/** HAL Layout
+ *
+ * The game reaches the hardware only through the Energia calls listed below, so this is the single place
+ * where the target is chosen and the FSM compiles unchanged on both:
+ * 1. Display --> Screen_HX8353E myScreen (clear, point, dRectangle, gText, calculateColour) and the display bus below
+ * 2. ADC --> analogReadResolution, analogRead
+ * 3. Buttons and LED --> pinMode, digitalRead, digitalWrite
+ * 4. Buzzer --> tone, noTone
+ * 5. Clock --> millis, micros, delay
+ * 6. RNG --> random, randomSeed
+ * 7. Timers --> Clock (Galaxia): callbacks run by the RTOS clock, preempting loop(), held by noInterrupts/interrupts
+ * 8. Serial port --> Serial (begin, available, read, print, println)
+ * 9. Cycle counter --> cycleCounterBegin, cycleCount (below)
+ * 10. Flash --> flashEraseSector, flashProgram, flashRead on the sectors reserved for saved data (below)
+ * 11. Sleep --> sleepBegin, sleepUntilWake, wakeUp: loop() waits for events in low-power mode instead of polling (below)
+ * 12. Display DMA --> lcdDmaBegin, lcdDmaCommand, lcdDmaData, lcdDmaWait: the display bus driven by the uDMA (below)
+ *
+ * With HOST_BUILD defined, host/hostEnergia.h and host/hostScreen.h provide the same names on Linux,
+ * with a simulated clock (which also fires the Clock callbacks) and an in-memory HX8353E that counts pixels, rectangles and bytes pushed.
+ *
+ */
+#define LCD_CASET 0x2A //HX8353E commands of the display bus, also decoded by the host mock
+#define LCD_RASET 0x2B
+#define LCD_RAMWR 0x2C
+#define LCD_VSCRDEF 0x33
+#define LCD_VSCSAD 0x37
+
+#ifdef HOST_BUILD
+#include "host/hostEnergia.h"
+#include "font5x7.h"
+#include "host/hostScreen.h"
+#else
+#include <LCD_screen.h>
+#include <LCD_screen_font.h>
+#include <LCD_utilities.h>
+#include <Screen_HX8353E.h>
+#include <Clock.h>
+#include "font5x7.h"
+#endif
+
+Screen_HX8353E myScreen;
+
+#define LCD_WIDTH 128 //HX8353E panel size
+#define LCD_HEIGHT 128
+
+/** Cycle counter
+ *
+ * Free-running 32-bit count of active CPU cycles, wrapping every ~89 s of activity at CPU_HZ:
+ * the DWT CYCCNT register of the Cortex-M4 on the LaunchPad, which stops with the CPU clock in LPM0.
+ * On the host: the busy time of the simulated clock (bus and peripherals, as the LaunchPad would spend it) plus the host
+ * CPU time of the sketch (hostCpuNs), both counted at CPU_HZ, so the compute phases are measured too, on a faster CPU.
+ *
+ */
+#define CPU_HZ 48000000UL //MSP432 MCLK
+
+#ifdef HOST_BUILD
+void cycleCounterBegin(){}
+uint32_t cycleCount(){ return (uint32_t)((hostNowNs - hostSleepNs + hostCpuNs())*(CPU_HZ/1000000)/1000); }
+#else
+#define DEMCR (*(volatile uint32_t *)0xE000EDFC) //Debug Exception and Monitor Control
+#define DWT_CTRL (*(volatile uint32_t *)0xE0001000)
+#define DWT_CYCCNT (*(volatile uint32_t *)0xE0001004)
+
+void cycleCounterBegin(){
+  DEMCR |= 0x01000000; //TRCENA: power the DWT unit
+  DWT_CYCCNT = 0;
+  DWT_CTRL |= 0x00000001; //CYCCNTENA
+}
+
+uint32_t cycleCount(){ return DWT_CYCCNT; }
+#endif
+
+/** Display bus
+ *
+ * Raw access to the HX8353E address window, used to push a whole region with a single window setup:
+ * 1. lcdWindow --> CASET + RASET + RAMWR on the inclusive rectangle (x1, y1) - (x2, y2)
+ * 2. lcdPushColour --> stream n pixels of the same colour into the open window
+ * 3. lcdPushPixels --> stream n RGB565 pixels from memory into the open window
+ * 4. lcdScrollArea --> VSCRDEF: rows top..top+height-1 become the vertical scroll area, the rows above and below stay fixed
+ * 5. lcdScrollStart --> VSCSAD: the first row of the scroll area shows memory row row, the next ones follow and wrap
+ *    inside the area. Moving everything in the area costs this one command; windows keep addressing memory rows
+ *
+ * Pins and commands are the ones used by the Screen_HX8353E driver on the BoosterPack MKII.
+ *
+ */
+#ifdef HOST_BUILD
+void lcdWindow(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2){ myScreen.hostWindow(x1, y1, x2, y2); }
+void lcdPushColour(uint16_t colour, uint32_t n){ myScreen.hostRepeat(colour, n); }
+void lcdPushPixels(const uint16_t *pixels, uint32_t n){ myScreen.hostPixels(pixels, n); }
+void lcdScrollArea(uint8_t top, uint8_t height){ myScreen.hostScrollArea(top, height); }
+void lcdScrollStart(uint8_t row){ myScreen.hostScrollStart(row); }
+#else
+#include <SPI.h>
+
+#define LCD_PIN_DC 31 //Data/Command pin
+#define LCD_PIN_CS 13 //Chip Select pin
+
+void lcdCommand(uint8_t command8){
+  digitalWrite(LCD_PIN_DC, LOW);
+  digitalWrite(LCD_PIN_CS, LOW);
+  SPI.transfer(command8);
+  digitalWrite(LCD_PIN_CS, HIGH);
+}
+
+void lcdData16(uint16_t data16a, uint16_t data16b){
+  digitalWrite(LCD_PIN_DC, HIGH);
+  digitalWrite(LCD_PIN_CS, LOW);
+  SPI.transfer(highByte(data16a));
+  SPI.transfer(lowByte(data16a));
+  SPI.transfer(highByte(data16b));
+  SPI.transfer(lowByte(data16b));
+  digitalWrite(LCD_PIN_CS, HIGH);
+}
+
+void lcdData16(uint16_t data16){
+  digitalWrite(LCD_PIN_DC, HIGH);
+  digitalWrite(LCD_PIN_CS, LOW);
+  SPI.transfer(highByte(data16));
+  SPI.transfer(lowByte(data16));
+  digitalWrite(LCD_PIN_CS, HIGH);
+}
+
+void lcdWindow(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2){
+  lcdCommand(LCD_CASET);
+  lcdData16(x1, x2);
+  lcdCommand(LCD_RASET);
+  lcdData16(y1, y2);
+  lcdCommand(LCD_RAMWR);
+}
+
+void lcdPushColour(uint16_t colour, uint32_t n){
+  digitalWrite(LCD_PIN_DC, HIGH);
+  digitalWrite(LCD_PIN_CS, LOW);
+  while(n--){
+    SPI.transfer(highByte(colour));
+    SPI.transfer(lowByte(colour));
+  }
+  digitalWrite(LCD_PIN_CS, HIGH);
+}
+
+void lcdPushPixels(const uint16_t *pixels, uint32_t n){
+  digitalWrite(LCD_PIN_DC, HIGH);
+  digitalWrite(LCD_PIN_CS, LOW);
+  while(n--){
+    SPI.transfer(highByte(*pixels));
+    SPI.transfer(lowByte(*pixels));
+    pixels++;
+  }
+  digitalWrite(LCD_PIN_CS, HIGH);
+}
+
+void lcdScrollArea(uint8_t top, uint8_t height){ //Fixed top rows, scroll rows, fixed bottom rows: the three add up to the panel
+  lcdCommand(LCD_VSCRDEF);
+  lcdData16(top, height);
+  lcdData16(LCD_HEIGHT - top - height);
+}
+
+void lcdScrollStart(uint8_t row){
+  lcdCommand(LCD_VSCSAD);
+  lcdData16(row);
+}
+#endif
+
+/** Flash
+ *
+ * FLASH_STORE_SECTORS sectors at the end of the main flash are reserved for data saved across power cycles
+ * (bank 1, sectors 28-31 of the MSP432P401R); s below is the sector index in that area:
+ * 1. flashEraseSector --> set every byte of sector s to 0xFF (blocks for a few ms)
+ * 2. flashProgram --> write n bytes at offset of sector s (bits can only go from 1 to 0), returns false if verify fails
+ * 3. flashRead --> copy n bytes from offset of sector s
+ *
+ * On the host, host/hostFlash.h emulates the sectors with the erase and program latencies of the part.
+ *
+ */
+#define FLASH_SECTOR_BYTES 4096
+#define FLASH_STORE_SECTORS 4
+
+#ifdef HOST_BUILD
+#include "host/hostFlash.h"
+#else
+#include <driverlib/rom_map.h>
+#include <driverlib/flash.h>
+
+#define FLASH_STORE_BASE 0x0003C000 //Bank 1, sector 28
+#define FLASH_STORE_FIRST FLASH_SECTOR28
+
+void flashEraseSector(uint8_t s){
+  MAP_FlashCtl_unprotectSector(FLASH_MAIN_MEMORY_SPACE_BANK1, FLASH_STORE_FIRST << s);
+  MAP_FlashCtl_eraseSector(FLASH_STORE_BASE + (uint32_t)s*FLASH_SECTOR_BYTES);
+  MAP_FlashCtl_protectSector(FLASH_MAIN_MEMORY_SPACE_BANK1, FLASH_STORE_FIRST << s);
+}
+
+bool flashProgram(uint8_t s, uint16_t offset, const void *data, uint16_t n){
+  MAP_FlashCtl_unprotectSector(FLASH_MAIN_MEMORY_SPACE_BANK1, FLASH_STORE_FIRST << s);
+  bool ok = MAP_FlashCtl_programMemory((void *)data, (void *)(FLASH_STORE_BASE + (uint32_t)s*FLASH_SECTOR_BYTES + offset), n);
+  MAP_FlashCtl_protectSector(FLASH_MAIN_MEMORY_SPACE_BANK1, FLASH_STORE_FIRST << s);
+  return ok;
+}
+
+void flashRead(uint8_t s, uint16_t offset, void *data, uint16_t n){
+  memcpy(data, (const void *)(FLASH_STORE_BASE + (uint32_t)s*FLASH_SECTOR_BYTES + offset), n);
+}
+#endif
+
+/** Sleep
+ *
+ * loop() blocks on a binary semaphore instead of polling:
+ * 1. sleepBegin --> create the semaphore
+ * 2. sleepUntilWake --> sleep until wakeUp() is called or ms elapse (SLEEP_FOREVER: no timeout), returns true if woken;
+ *    a wakeUp() that came before the call returns at once, so an event raised between a check and the sleep is not lost
+ * 3. wakeUp --> from interrupts and Clock callbacks: something is waiting for loop()
+ *
+ * While loop() is blocked the RTOS runs its idle task, which puts the MSP432 in LPM0 until the next interrupt; only
+ * the Clocks that are running (and the pin interrupts) wake it, so an idle page with no Clock wakes up for nothing.
+ * On the host the simulated clock moves one RTOS tick at a time until the wake or the timeout, counted as sleep.
+ *
+ */
+#define SLEEP_FOREVER 0xFFFFFFFFUL
+#define IDLE_POLL_MS 100 //Pages waiting for the player wake up this often to look at the serial port (profiler commands)
+
+#ifdef HOST_BUILD
+volatile bool sleepWoken = false;
+
+void sleepBegin(){ sleepWoken = false; }
+
+bool sleepUntilWake(uint32_t ms){
+  if(hostDelayHook != NULL){ hostRunHook(hostDelayHook); }
+  hostSleepCalls++;
+  for(uint32_t i = 0; (i < ms) && !sleepWoken; i++){ hostSleep(HOST_CLOCK_TICK_NS); }
+  bool woken = sleepWoken;
+  sleepWoken = false;
+  return woken;
+}
+
+void wakeUp(){ sleepWoken = true; }
+#else
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Semaphore.h>
+
+Semaphore_Handle sleepSemaphore = NULL;
+
+void sleepBegin(){
+  Semaphore_Params params;
+  Semaphore_Params_init(&params);
+  params.mode = Semaphore_Mode_BINARY;
+  sleepSemaphore = Semaphore_create(0, &params, NULL);
+}
+
+bool sleepUntilWake(uint32_t ms){ //Energia MT ticks are 1 ms
+  return Semaphore_pend(sleepSemaphore, (ms == SLEEP_FOREVER) ? BIOS_WAIT_FOREVER : ms);
+}
+
+void wakeUp(){
+  if(sleepSemaphore != NULL){ Semaphore_post(sleepSemaphore); }
+}
+#endif
+
+/** Display DMA
+ *
+ * The display bus without the CPU in the loop, for displayQueue.h:
+ * 1. lcdDmaBegin --> set up the channel; done is called in interrupt context when a transfer has left the SPI
+ * 2. lcdDmaCommand --> one command byte and n parameter bytes, clocked by the CPU through the eUSCI registers (the DC pin
+ *    changes in between)
+ * 3. lcdDmaData --> start sending n data bytes from memory, which must stay untouched until done is called
+ * 4. lcdDmaWait --> sleep until the next transfer interrupt, or one RTOS tick
+ *
+ * On the LaunchPad the uDMA feeds the eUSCI_B0 transmit buffer in transfers of up to 1024 bytes, chained in a SYS/BIOS
+ * hardware interrupt.
+ * On the host a transfer takes HOST_DMA_LATENCY_NS plus HOST_DMA_NS_PER_BYTE per byte of simulated time, during which the
+ * CPU goes on, and ends with a peripheral interrupt (hostIrqRaise).
+ *
+ */
+#ifdef HOST_BUILD
+#ifndef HOST_DMA_NS_PER_BYTE
+#define HOST_DMA_NS_PER_BYTE 667 //12 MHz SPI clock, bytes back to back
+#endif
+#ifndef HOST_DMA_LATENCY_NS
+#define HOST_DMA_LATENCY_NS 3000 //Channel setup and end of transfer interrupt
+#endif
+
+void (*lcdDmaDone)(void) = NULL;
+uint64_t hostDmaNs = 0; //Simulated time the bus spent in DMA transfers
+
+void lcdDmaBegin(void (*done)(void)){ lcdDmaDone = done; }
+void lcdDmaCommand(uint8_t command, const uint8_t *params, uint8_t n){ myScreen.hostCommand(command, params, n); }
+
+void lcdDmaData(const uint8_t *data, uint16_t n){
+  uint64_t ns = HOST_DMA_LATENCY_NS + (uint64_t)n*HOST_DMA_NS_PER_BYTE;
+  myScreen.hostData(data, n);
+  hostDmaNs += ns;
+  hostIrqRaise(HOST_IRQ_DMA, lcdDmaDone, hostNowNs + ns);
+}
+
+void lcdDmaWait(){ hostIrqSleep(); }
+#else
+#include <driverlib/dma.h>
+#include <driverlib/spi.h>
+#include <driverlib/gpio.h>
+#include <driverlib/interrupt.h>
+#include <ti/sysbios/hal/Hwi.h>
+
+#define LCD_SPI_BASE EUSCI_B0_BASE //SPI of the BoosterPack LCD
+#define LCD_DMA_CHANNEL DMA_CH0_EUSCIB0TX0
+#define LCD_DMA_MAX 1024 //Bytes per uDMA transfer
+#define LCD_DC_PORT GPIO_PORT_P3 //LCD_PIN_DC
+#define LCD_DC_BIT GPIO_PIN7
+#define LCD_CS_PORT GPIO_PORT_P5 //LCD_PIN_CS
+#define LCD_CS_BIT GPIO_PIN0
+
+//The uDMA has a single control table base. Nothing else in the sketch programs the uDMA (the SPI library and adcSampler.h
+//move their bytes with the CPU), so lcdDmaBegin installs this table; if a driver got there first its table is shared
+//instead, since only the primary entry of LCD_DMA_CHANNEL is written and every channel has its own slot
+uint8_t lcdDmaControl[1024] __attribute__((aligned(1024))); //uDMA control table
+void (*lcdDmaDone)(void) = NULL;
+const uint8_t *lcdDmaNext = NULL;
+volatile uint16_t lcdDmaLeft = 0;
+Semaphore_Handle lcdDmaSemaphore = NULL;
+
+//The functions below also run in the DMA interrupt: they drive the eUSCI and the pins through their registers, never
+//through the SPI object or digitalWrite
+void lcdDmaSelect(bool data){
+  if(data){ MAP_GPIO_setOutputHighOnPin(LCD_DC_PORT, LCD_DC_BIT); }
+  else{ MAP_GPIO_setOutputLowOnPin(LCD_DC_PORT, LCD_DC_BIT); }
+  MAP_GPIO_setOutputLowOnPin(LCD_CS_PORT, LCD_CS_BIT);
+}
+
+void lcdDmaRelease(){
+  while(MAP_SPI_isBusy(LCD_SPI_BASE)); //Last byte still shifting out
+  (void)EUSCI_B_CMSIS(LCD_SPI_BASE)->RXBUF; //Clear the receive flag the SPI library waits on
+  MAP_GPIO_setOutputHighOnPin(LCD_CS_PORT, LCD_CS_BIT);
+}
+
+void lcdDmaByte(uint8_t b){
+  while(!(EUSCI_B_CMSIS(LCD_SPI_BASE)->IFG & EUSCI_B_IFG_TXIFG));
+  EUSCI_B_CMSIS(LCD_SPI_BASE)->TXBUF = b;
+}
+
+void lcdDmaChunk(){
+  uint16_t n = min(lcdDmaLeft, (uint16_t)LCD_DMA_MAX);
+  MAP_DMA_setChannelTransfer(LCD_DMA_CHANNEL | UDMA_PRI_SELECT, UDMA_MODE_BASIC, (void *)lcdDmaNext,
+                             (void *)MAP_SPI_getTransmitBufferAddressForDMA(LCD_SPI_BASE), n);
+  lcdDmaNext += n;
+  lcdDmaLeft -= n;
+  MAP_DMA_enableChannel(LCD_DMA_CHANNEL & 0x0F);
+}
+
+void lcdDmaIsr(UArg arg){ //Dispatched by SYS/BIOS (Hwi_create), so Semaphore_post is allowed
+  MAP_DMA_clearInterruptFlag(LCD_DMA_CHANNEL & 0x0F);
+  if(lcdDmaLeft > 0){ lcdDmaChunk(); return; }
+  lcdDmaRelease();
+  Semaphore_post(lcdDmaSemaphore);
+  lcdDmaDone();
+}
+
+void lcdDmaBegin(void (*done)(void)){
+  lcdDmaDone = done;
+  Semaphore_Params params;
+  Semaphore_Params_init(&params);
+  params.mode = Semaphore_Mode_BINARY;
+  lcdDmaSemaphore = Semaphore_create(0, &params, NULL);
+  MAP_DMA_enableModule();
+  if(MAP_DMA_getControlBase() == NULL){ MAP_DMA_setControlBase(lcdDmaControl); }
+  MAP_DMA_assignChannel(LCD_DMA_CHANNEL);
+  MAP_DMA_setChannelControl(LCD_DMA_CHANNEL | UDMA_PRI_SELECT, UDMA_SIZE_8 | UDMA_SRC_INC_8 | UDMA_DST_INC_NONE | UDMA_ARB_1);
+  MAP_DMA_assignInterrupt(DMA_INT1, LCD_DMA_CHANNEL & 0x0F);
+  Hwi_Params hwiParams;
+  Hwi_Params_init(&hwiParams);
+  Hwi_create(INT_DMA_INT1, lcdDmaIsr, &hwiParams, NULL); //Enabled on creation
+}
+
+void lcdDmaCommand(uint8_t command, const uint8_t *params, uint8_t n){
+  lcdDmaSelect(false);
+  lcdDmaByte(command);
+  lcdDmaRelease(); //The DC pin changes only once the command has left
+  if(n == 0){ return; }
+  lcdDmaSelect(true);
+  while(n--){ lcdDmaByte(*params++); }
+  lcdDmaRelease();
+}
+
+void lcdDmaData(const uint8_t *data, uint16_t n){
+  lcdDmaSelect(true);
+  lcdDmaNext = data;
+  lcdDmaLeft = n;
+  lcdDmaChunk();
+}
+
+void lcdDmaWait(){ Semaphore_pend(lcdDmaSemaphore, 1); }
+#endif
@@ -0,0 +1,127 @@
+/**
+ * @file assetConvert.cpp
+ *
+ * @brief Host asset converter: turns an image into a compressed const asset for assetCodec.h and reports flash size per codec
+ *
+ * Build and run from the sketch folder:
+ *   g++ -std=c++11 -O2 host/assetConvert.cpp -o assetConvert
+ *   ./assetConvert <input> <name> <width> <height> [raw|rle|pal4|pal8|palrle|best] [--column-major] > asset.h
+ *
+ * Input is either a binary PPM (P6) or a C source holding an array of RGB565 values, such as png2c output.
+ * The generated arrays go to stdout, the size of every codec goes to stderr.
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+#define HOST_BUILD
+#include "../hal.h"
+#include "../assetCodec.h"
+#include "assetEncoder.h"
+
+const char *codecOptions[NUM_CODECS] = {"raw", "rle", "pal4", "pal8", "palrle"};
+
+/** Input functions
+ *
+ * readPpm --> binary PPM, RGB888 converted to RGB565
+ * readArray --> every number between the first '{' and the following '}'
+ *
+ */
+bool readPpm(FILE *f, std::vector<uint16_t> &pixels, int width, int height){
+  int w, h, maxval;
+  if(fscanf(f, "P6 %d %d %d", &w, &h, &maxval) != 3 || w != width || h != height || maxval != 255){ return false; }
+  fgetc(f);
+  for(int i = 0; i < w*h; i++){
+    int r = fgetc(f), g = fgetc(f), b = fgetc(f);
+    if(b == EOF){ return false; }
+    pixels.push_back((r >> 3) << 11 | (g >> 2) << 5 | (b >> 3));
+  }
+  return true;
+}
+
+bool readArray(FILE *f, std::vector<uint16_t> &pixels){
+  int c;
+  while(((c = fgetc(f)) != EOF) && (c != '{'));
+  char token[16];
+  int n = 0;
+  while((c = fgetc(f)) != EOF){
+    if(isalnum(c) && n < 15){ token[n++] = c; continue; }
+    if(n > 0){ token[n] = 0; pixels.push_back(strtoul(token, NULL, 0)); n = 0; }
+    if(c == '}'){ return true; }
+  }
+  return false;
+}
+
+void printArray(const char *type, const char *name, const char *suffix, const uint8_t *bytes, const uint16_t *words, size_t n){
+  printf("static const %s %s_%s[] = {", type, name, suffix);
+  for(size_t i = 0; i < n; i++){
+    if(i > 0){ printf(","); }
+    if(i % 16 == 0){ printf("\n  "); } else{ printf(" "); }
+    if(bytes){ printf("0x%02X", bytes[i]); }
+    else{ printf("0x%04X", words[i]); }
+  }
+  printf("\n};\n\n");
+}
+
+int main(int argc, char **argv){
+  if(argc < 5){
+    fprintf(stderr, "usage: %s <input> <name> <width> <height> [raw|rle|pal4|pal8|palrle|best] [--column-major]\n", argv[0]);
+    return 1;
+  }
+  const char *input = argv[1];
+  const char *name = argv[2];
+  int width = atoi(argv[3]);
+  int height = atoi(argv[4]);
+  int codec = -1; //best
+  bool columnMajor = false;
+  for(int i = 5; i < argc; i++){
+    if(strcmp(argv[i], "--column-major") == 0){ columnMajor = true; continue; }
+    for(int k = 0; k < NUM_CODECS; k++){ if(strcmp(argv[i], codecOptions[k]) == 0){ codec = k; } }
+  }
+
+  FILE *f = fopen(input, "rb");
+  if(f == NULL){ fprintf(stderr, "cannot open %s\n", input); return 1; }
+  std::vector<uint16_t> pixels;
+  bool ok = (strstr(input, ".ppm") != NULL) ? readPpm(f, pixels, width, height) : readArray(f, pixels);
+  fclose(f);
+  if(!ok || pixels.size() != (size_t)width*height){ fprintf(stderr, "%s: expected %dx%d pixels\n", input, width, height); return 1; }
+
+  if(columnMajor){ //Assets are always stored row after row
+    std::vector<uint16_t> t(pixels.size());
+    for(int x = 0; x < width; x++){
+      for(int y = 0; y < height; y++){ t[y*width + x] = pixels[x*height + y]; }
+    }
+    pixels = t;
+  }
+
+  //Encode with every codec, check the round trip with the device decoder and pick the smallest
+  EncodedAsset_t encoded[NUM_CODECS];
+  int best = CODEC_RAW;
+  fprintf(stderr, "%s: %dx%d\n", name, width, height);
+  for(int k = 0; k < NUM_CODECS; k++){
+    encoded[k] = encodeAsset(pixels, k);
+    if(!encoded[k].valid){ fprintf(stderr, "  %-14s too many colours\n", codecNames[k]); continue; }
+
+    Asset_t a = assetView(encoded[k], width, height);
+    AssetDecoder_t dec;
+    std::vector<uint16_t> decoded(pixels.size());
+    assetBegin(&dec, &a, 0, 0);
+    assetDecode(&dec, &decoded[0], decoded.size());
+    if(decoded != pixels){ fprintf(stderr, "  %-14s round trip FAILED\n", codecNames[k]); return 1; }
+
+    fprintf(stderr, "  %-14s %6u bytes of flash\n", codecNames[k], assetFlashSize(&a));
+    Asset_t b = assetView(encoded[best], width, height);
+    if(assetFlashSize(&a) < assetFlashSize(&b)){ best = k; }
+  }
+  if(codec < 0){ codec = best; }
+  if(!encoded[codec].valid){ fprintf(stderr, "%s cannot encode this image\n", codecNames[codec]); return 1; }
+
+  EncodedAsset_t &e = encoded[codec];
+  Asset_t a = assetView(e, width, height);
+  printf("/**\n * Asset generated by host/assetConvert: %dx%d, %s, %u bytes of flash\n */\n", width, height, codecNames[codec], assetFlashSize(&a));
+  if(!e.palette.empty()){ printArray("uint16_t", name, "palette", NULL, &e.palette[0], e.palette.size()); }
+  printArray("uint8_t", name, "data", &e.data[0], NULL, e.data.size());
+  printf("const Asset_t %s = {%d, %d, %s, %u, ", name, width, height, codecNames[codec], (unsigned)e.palette.size());
+  if(e.palette.empty()){ printf("NULL, "); } else{ printf("%s_palette, ", name); }
+  printf("%s_data, sizeof(%s_data)};\n", name, name);
+  return 0;
+}
@@ -0,0 +1,122 @@
+/**
+ * @file assetEncoder.h
+ *
+ * @brief Host-side encoders for the asset codecs decoded by assetCodec.h
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+#include <vector>
+
+const char *codecNames[NUM_CODECS] = {"CODEC_RAW", "CODEC_RLE", "CODEC_PAL4", "CODEC_PAL8", "CODEC_PAL_RLE"};
+
+/**
+ * Encoded asset: owns palette and data so that an Asset_t can point into it
+ */
+typedef struct{
+  uint8_t codec;
+  std::vector<uint16_t> palette;
+  std::vector<uint8_t> data;
+  bool valid; //false when the image has too many colours for the codec
+}EncodedAsset_t;
+
+/** Palette function
+ *
+ * Collect the distinct colours of the image in order of first appearance and map every pixel to its index
+ *
+ */
+void buildPalette(const std::vector<uint16_t> &pixels, std::vector<uint16_t> &palette, std::vector<uint16_t> &indices){
+  palette.clear();
+  indices.clear();
+  for(size_t i = 0; i < pixels.size(); i++){
+    size_t k = 0;
+    while((k < palette.size()) && (palette[k] != pixels[i])){ k++; }
+    if(k == palette.size()){ palette.push_back(pixels[i]); }
+    indices.push_back(k);
+  }
+}
+
+/** RLE function
+ *
+ * PackBits-style packets on values of valueBytes bytes: runs of at least minRun equal values become
+ * a run packet, everything else is grouped in literal packets of up to 128 values
+ *
+ */
+void encodeRle(const std::vector<uint16_t> &values, uint8_t valueBytes, std::vector<uint8_t> &out){
+  size_t minRun = (valueBytes == 2) ? 2 : 3;
+  size_t i = 0;
+  while(i < values.size()){
+    size_t r = 1;
+    while((i+r < values.size()) && (r < 128) && (values[i+r] == values[i])){ r++; }
+    if(r >= minRun){
+      out.push_back(RLE_RUN + r-1);
+      if(valueBytes == 2){ out.push_back(values[i] >> 8); }
+      out.push_back(values[i] & 0xFF);
+      i += r;
+      continue;
+    }
+    size_t start = i;
+    size_t n = 0;
+    while((i < values.size()) && (n < 128)){ //Literals until the next worthwhile run
+      size_t rr = 1;
+      while((i+rr < values.size()) && (rr < minRun) && (values[i+rr] == values[i])){ rr++; }
+      if(rr >= minRun){ break; }
+      i++;
+      n++;
+    }
+    out.push_back(n-1);
+    for(size_t k = start; k < start+n; k++){
+      if(valueBytes == 2){ out.push_back(values[k] >> 8); }
+      out.push_back(values[k] & 0xFF);
+    }
+  }
+}
+
+/** Encode function
+ *
+ * Encode row-major RGB565 pixels with the given codec
+ *
+ */
+EncodedAsset_t encodeAsset(const std::vector<uint16_t> &pixels, uint8_t codec){
+  EncodedAsset_t e;
+  e.codec = codec;
+  e.valid = true;
+
+  std::vector<uint16_t> indices;
+  if(codec != CODEC_RAW && codec != CODEC_RLE){
+    buildPalette(pixels, e.palette, indices);
+    if(e.palette.size() > ((codec == CODEC_PAL4) ? 16u : 256u)){ e.valid = false; return e; }
+  }
+
+  switch(codec){
+    case CODEC_RAW:
+      for(size_t i = 0; i < pixels.size(); i++){ e.data.push_back(pixels[i] >> 8); e.data.push_back(pixels[i] & 0xFF); }
+      break;
+    case CODEC_RLE:
+      encodeRle(pixels, 2, e.data);
+      break;
+    case CODEC_PAL4:
+      for(size_t i = 0; i < indices.size(); i += 2){
+        uint8_t lo = (i+1 < indices.size()) ? indices[i+1] : 0;
+        e.data.push_back((indices[i] << 4) | lo);
+      }
+      break;
+    case CODEC_PAL8:
+      for(size_t i = 0; i < indices.size(); i++){ e.data.push_back(indices[i]); }
+      break;
+    case CODEC_PAL_RLE:
+      encodeRle(indices, 1, e.data);
+      break;
+  }
+  return e;
+}
+
+/** Asset view function
+ *
+ * Asset_t descriptor pointing into an encoded asset, as the generated header would define it
+ *
+ */
+Asset_t assetView(const EncodedAsset_t &e, uint8_t width, uint8_t height){
+  Asset_t a = {width, height, e.codec, (uint16_t)e.palette.size(), e.palette.empty() ? NULL : &e.palette[0], &e.data[0], (uint32_t)e.data.size()};
+  return a;
+}
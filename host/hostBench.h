@@ -0,0 +1,378 @@
+/**
+ * @file hostBench.h
+ *
+ * @brief Host benchmark suite: scripted scenarios on the mock display, per-frame cost in CSV or JSON, regression check against a baseline
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/** Benchmark
+ *
+ * Every scenario is cut in frames and every frame is charged its busy time (simulated time minus sleeps), the host CPU
+ * time of the sketch (hostCpuNs), its draw calls, its bus traffic and its heap allocations (malloc and new, see
+ * hostEnergia.h).
+ * 1. logo --> the logo drawn once, one frame
+ * 2. menu_<page> --> a settings page left idle for BENCH_IDLE_MS, one frame per poll (the first one draws the page)
+ * 3. cmd_menu, cmd_game --> the same with the command pages, polled every IDLE_POLL_MS
+ * 4. game_<difficulty>_<n> --> BENCH_GAME_FRAMES game frames with n blocks on the road, frames are the scheduler ones
+ * 5. game_over --> the game over page drawn once, one frame
+ *
+ * Simulated time is deterministic, so two runs of the same tree give the same numbers and any difference is a change.
+ * The simulated clock only sees the bus, so game logic is watched by the cpu_* columns: real time, only comparable
+ * between runs on the same machine. The suite is played BENCH_CPU_RUNS times, each in a fork of the set-up runner so
+ * that every run plays the same frames, and every frame keeps its fastest time, which leaves out most interruptions.
+ * With a baseline (a CSV written by an earlier run) every metric larger than baseline*(1 + percent/100) is a regression
+ * and the run exits with status 1, as does a baseline scenario the run did not produce. The cpu_* columns move by a
+ * few percent between runs, so they have their own threshold (cpuPercent) and BENCH_CPU_SLACK_US of slack.
+ *
+ */
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#define BENCH_IDLE_MS 1000
+#define BENCH_GAME_FRAMES 300
+#define BENCH_PRESS_MS 50 //Pages that wait for a button are left after this time
+#define BENCH_METRICS 15
+#define BENCH_CPU_RUNS 9
+#define BENCH_CPU_FIRST 12 //First cpu_* metric
+#define BENCH_CPU_SLACK_US 1.0
+#define BENCH_MAX_FRAMES 16384 //Frames of the whole suite, for the fastest times of the runs
+
+typedef struct{
+  std::string name;
+  std::vector<uint64_t> work; //Busy time of every frame (ns)
+  std::vector<uint64_t> cpu; //Host CPU time of every frame (ns)
+  uint64_t rect, text, point, pixels, bytes, allocs; //Totals over the frames
+}BenchScenario_t;
+
+typedef struct{
+  uint64_t sleepNs, nowNs, cpuNs;
+  HostScreenStats_t screen;
+  uint32_t allocs;
+}BenchSnapshot_t;
+
+const char *benchMetricNames[BENCH_METRICS] = {"frames", "p50_us", "p90_us", "p99_us", "max_us", "rect", "text", "point", "pixels", "bytes", "allocs", "mean_us",
+                                                 "cpu_p50_us", "cpu_p99_us", "cpu_mean_us"};
+
+std::vector<BenchScenario_t> benchScenarios;
+BenchScenario_t *benchCurrent = NULL;
+BenchSnapshot_t benchLast;
+
+//Frame boundaries detected by the hooks
+uint32_t benchGameFrames = 0; //gameFrames.frames at the last game frame sampled
+uint64_t benchPressNs = 0; //When S2 is pressed (0 = never)
+
+/** Screen counters
+ *
+ * The mock screen counters, with the text drawn by textRenderer.h counted as text calls like gText()
+ *
+ */
+HostScreenStats_t hostScreenStats(){
+  HostScreenStats_t s = myScreen.stats;
+  s.textCalls += textStats.draws;
+  return s;
+}
+
+BenchSnapshot_t benchSnapshot(){
+  BenchSnapshot_t s = {hostSleepNs, hostNowNs, hostCpuNs(), hostScreenStats(), hostHeapAllocs};
+  return s;
+}
+
+/** Frame sampling functions
+ *
+ * 1. benchBegin --> open a scenario, counters start from now
+ * 2. benchFrame --> close a frame: charge what happened since the previous one, work_ns overrides the busy time (the host
+ *    CPU time is always measured)
+ * 3. benchHook --> tick hook: drives the joystick in game, finds game frame boundaries and presses S2 when asked
+ * 4. benchPoll --> delay hook of the menu scenarios: a poll ends when the menu goes to sleep
+ * 5. benchRelease --> release S2 and drop its events
+ *
+ */
+void benchBegin(const char *name){
+  BenchScenario_t sc;
+  sc.name = name;
+  sc.rect = sc.text = sc.point = sc.pixels = sc.bytes = sc.allocs = 0;
+  benchScenarios.push_back(sc);
+  benchCurrent = &benchScenarios.back();
+  benchLast = benchSnapshot();
+}
+
+void benchFrame(uint64_t work_ns = 0){
+  HostHeapPause pause; //The bench's own bookkeeping is charged to no frame
+  HostCpuScope cpu(false);
+  BenchSnapshot_t now = benchSnapshot();
+  if(work_ns == 0){ work_ns = (now.nowNs - benchLast.nowNs) - (now.sleepNs - benchLast.sleepNs); }
+  benchCurrent->work.push_back(work_ns);
+  benchCurrent->cpu.push_back(now.cpuNs - benchLast.cpuNs);
+  benchCurrent->rect += now.screen.rectangleCalls - benchLast.screen.rectangleCalls;
+  benchCurrent->text += now.screen.textCalls - benchLast.screen.textCalls;
+  benchCurrent->point += now.screen.pointCalls - benchLast.screen.pointCalls;
+  benchCurrent->pixels += now.screen.pixels - benchLast.screen.pixels;
+  benchCurrent->bytes += now.screen.bytes - benchLast.screen.bytes;
+  benchCurrent->allocs += now.allocs - benchLast.allocs;
+  benchLast = now;
+}
+
+void benchHook(){
+  if((benchPressNs != 0) && (hostNowNs >= benchPressNs)){ hostSetPin(buttonTwo, LOW); }
+  if(current_state == STATE_GAME){ //Same player as the default run
+    double t = hostNowNs/1e9;
+    hostAnalogValue[joystickX] = 2048 + (int)(1800*sin(t*1.3));
+    hostAnalogValue[joystickY] = 2048 + (int)(300*sin(t*7.1));
+  }
+  if((current_state == STATE_GAME) && (gameFrames.frames != benchGameFrames)){ //frameSchedulerWait() ended a frame
+    benchGameFrames = gameFrames.frames;
+    benchFrame(gameFrames.work_us*1000ULL);
+    if(benchCurrent->work.size() >= BENCH_GAME_FRAMES){ hostDeadlineNs = hostNowNs; } //Stop right after this hook
+  }
+}
+
+void benchPoll(){
+  benchFrame();
+}
+
+void benchRelease(){
+  benchPressNs = 0;
+  hostDelayHook = NULL;
+  hostSetPin(buttonTwo, HIGH);
+  delay(BUTTON_DEBOUNCE_MS+1);
+  buttonFlush();
+}
+
+/** Scenario functions
+ *
+ * Each one sets up the state the FSM would have reached and runs the unchanged drawing or state code
+ *
+ */
+void benchLogo(){
+  myScreen.clear(whiteColour);
+  benchBegin("logo");
+  displayLogo();
+  benchFrame();
+}
+
+void benchMenu(const char *name, const MenuPage_t *page){
+  benchBegin(name);
+  hostDelayHook = benchPoll;
+  benchPressNs = hostNowNs + BENCH_IDLE_MS*1000000ULL;
+  menuRun(page, applySetting);
+  benchRelease();
+}
+
+void benchPage(const char *name, void (*page)(void)){
+  benchBegin(name);
+  hostDelayHook = benchPoll;
+  benchPressNs = hostNowNs + BENCH_IDLE_MS*1000000ULL;
+  page();
+  benchRelease();
+}
+
+void benchGame(const char *name, uint8_t difficulty, uint8_t n){
+  for(uint8_t k = 0; k < MENU_EFFECTS; k++){
+    const MenuEffect_t *e = &difficultyOptions[difficulty].effects[k];
+    if(e->setting != MENU_NONE){ applySetting(e->setting, e->value); }
+  }
+  blocksNumber = n;
+  benchBegin(name);
+
+  while(benchCurrent->work.size() < BENCH_GAME_FRAMES){ //A collision restarts the game until enough frames are taken
+    fn_STATE_INIT_GAME();
+    for(uint8_t k = 0; k < n; k++){ //Road already full: blocks spread above the car
+      spawnBlock();
+      blockMove(blockActive[blockCount-1], blockX[blockActive[blockCount-1]], k*(LCD_HEIGHT-offset-2*carLength)/n);
+      roadPlace(blockActive[blockCount-1]);
+    }
+    benchGameFrames = 0;
+    benchLast = benchSnapshot();
+    try{ fn_STATE_GAME(); }
+    catch(HostStop &){ hostDeadlineNs = 0; roadEnd(); } //Stopped mid-frame: drain the display queue as a game end would
+  }
+  current_state = STATE_CMD_GAME;
+}
+
+void benchGameOver(){
+  score = 42;
+  benchBegin("game_over");
+  benchPressNs = hostNowNs + BENCH_PRESS_MS*1000000ULL;
+  fn_STATE_GAME_OVER();
+  benchFrame(); //Waiting for S2 is sleep time, so the busy time is the page drawing
+  benchRelease();
+}
+
+/** Output functions
+ *
+ * benchMetrics --> the BENCH_METRICS values of a scenario (times in us, counts per frame)
+ * benchCsv/benchJson --> print every scenario
+ *
+ */
+double benchPercentile(std::vector<uint64_t> sorted, double p){
+  if(sorted.empty()){ return 0; }
+  size_t k = (size_t)(p*(sorted.size()-1) + 0.5);
+  return sorted[k]/1e3;
+}
+
+void benchMetrics(const BenchScenario_t *sc, double *m){
+  std::vector<uint64_t> sorted = sc->work;
+  std::sort(sorted.begin(), sorted.end());
+  double frames = sorted.size() ? sorted.size() : 1;
+  uint64_t total = 0;
+  for(size_t k = 0; k < sorted.size(); k++){ total += sorted[k]; }
+  m[0] = sorted.size();
+  m[1] = benchPercentile(sorted, 0.50);
+  m[2] = benchPercentile(sorted, 0.90);
+  m[3] = benchPercentile(sorted, 0.99);
+  m[4] = sorted.empty() ? 0 : sorted.back()/1e3;
+  m[5] = sc->rect/frames;
+  m[6] = sc->text/frames;
+  m[7] = sc->point/frames;
+  m[8] = sc->pixels/frames;
+  m[9] = sc->bytes/frames;
+  m[10] = sc->allocs/frames;
+  m[11] = total/1e3/frames;
+  sorted = sc->cpu;
+  std::sort(sorted.begin(), sorted.end());
+  total = 0;
+  for(size_t k = 0; k < sorted.size(); k++){ total += sorted[k]; }
+  m[12] = benchPercentile(sorted, 0.50);
+  m[13] = benchPercentile(sorted, 0.99);
+  m[14] = total/1e3/frames;
+}
+
+void benchCsv(FILE *f){
+  fprintf(f, "scenario");
+  for(int k = 0; k < BENCH_METRICS; k++){ fprintf(f, ",%s", benchMetricNames[k]); }
+  fprintf(f, "\n");
+  for(size_t s = 0; s < benchScenarios.size(); s++){
+    double m[BENCH_METRICS];
+    benchMetrics(&benchScenarios[s], m);
+    fprintf(f, "%s", benchScenarios[s].name.c_str());
+    for(int k = 0; k < BENCH_METRICS; k++){ fprintf(f, ",%.3f", m[k]); }
+    fprintf(f, "\n");
+  }
+}
+
+void benchJson(FILE *f){
+  fprintf(f, "{\n  \"frame_rate_hz\": %d,\n  \"scenarios\": [\n", FRAME_RATE_HZ);
+  for(size_t s = 0; s < benchScenarios.size(); s++){
+    double m[BENCH_METRICS];
+    benchMetrics(&benchScenarios[s], m);
+    fprintf(f, "    {\"scenario\": \"%s\"", benchScenarios[s].name.c_str());
+    for(int k = 0; k < BENCH_METRICS; k++){ fprintf(f, ", \"%s\": %.3f", benchMetricNames[k], m[k]); }
+    fprintf(f, "}%s\n", (s+1 < benchScenarios.size()) ? "," : "");
+  }
+  fprintf(f, "  ]\n}\n");
+}
+
+/** Regression function
+ *
+ * Compare every metric but the frame count with the baseline CSV, report the regressions on stderr and
+ * return how many there are; a baseline scenario missing from the run counts as one (scenarios missing from the
+ * baseline are skipped)
+ *
+ */
+int benchCompare(const char *path, double percent, double cpuPercent){
+  FILE *f = fopen(path, "r");
+  if(f == NULL){ fprintf(stderr, "cannot open baseline %s\n", path); return 1; }
+  int regressions = 0;
+  char line[512];
+  if(fgets(line, sizeof(line), f) == NULL){ fclose(f); return 0; } //Header
+  while(fgets(line, sizeof(line), f) != NULL){
+    char *name = strtok(line, ",\n");
+    if(name == NULL){ continue; }
+    double base[BENCH_METRICS];
+    int k = 0;
+    for(char *v = strtok(NULL, ",\n"); (v != NULL) && (k < BENCH_METRICS); v = strtok(NULL, ",\n")){ base[k++] = atof(v); }
+    if(k < BENCH_METRICS){ continue; }
+
+    bool found = false;
+    for(size_t s = 0; s < benchScenarios.size(); s++){
+      if(benchScenarios[s].name != name){ continue; }
+      found = true;
+      double m[BENCH_METRICS];
+      benchMetrics(&benchScenarios[s], m);
+      for(k = 1; k < BENCH_METRICS; k++){
+        bool cpu = (k >= BENCH_CPU_FIRST);
+        if(m[k] > base[k]*(1 + (cpu ? cpuPercent : percent)/100) + (cpu ? BENCH_CPU_SLACK_US : 0.0005)){
+          fprintf(stderr, "regression: %s %s %.3f -> %.3f\n", name, benchMetricNames[k], base[k], m[k]);
+          regressions++;
+        }
+      }
+    }
+    if(!found){
+      fprintf(stderr, "regression: %s missing from the run\n", name);
+      regressions++;
+    }
+  }
+  fclose(f);
+  return regressions;
+}
+
+/** Benchmark run functions
+ *
+ * 1. benchSuite --> run every scenario
+ * 2. benchFastest --> fold the host CPU times of the frames into best, frame by frame in suite order (take = false), or
+ *    replace them with it (take = true)
+ * 3. benchRun --> run the suite BENCH_CPU_RUNS times, print the results and return the exit status of the program
+ *
+ */
+void benchSuite(){
+  const char *difficulties[N_diff] = {"rookie", "champion", "legend"};
+  benchLogo();
+  benchPage("cmd_menu", fn_STATE_CMD_MENU);
+  benchMenu("menu_car", &carPage);
+  benchMenu("menu_difficulty", &difficultyPage);
+  benchMenu("menu_mode", &modePage);
+  benchPage("cmd_game", fn_STATE_CMD_GAME);
+  for(uint8_t d = 0; d < N_diff; d++){
+    for(uint8_t n = 1; n <= 7; n++){
+      char name[32];
+      snprintf(name, sizeof(name), "game_%s_%u", difficulties[d], n);
+      benchGame(name, d, n);
+    }
+  }
+  benchGameOver();
+}
+
+void benchFastest(uint64_t *best, bool take){
+  uint32_t f = 0;
+  for(size_t s = 0; s < benchScenarios.size(); s++){
+    std::vector<uint64_t> &cpu = benchScenarios[s].cpu;
+    for(size_t k = 0; (k < cpu.size()) && (f < BENCH_MAX_FRAMES); k++, f++){
+      if(take){ cpu[k] = min(cpu[k], best[f]); }
+      else{ best[f] = min(best[f], cpu[k]); }
+    }
+  }
+}
+
+int benchRun(bool json, const char *baseline, double percent, double cpuPercent){
+  hostResetPins();
+  setup();
+  hostTickHook = benchHook;
+
+  uint64_t *best = (uint64_t *)mmap(NULL, BENCH_MAX_FRAMES*sizeof(uint64_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if(best == MAP_FAILED){ perror("mmap"); return 1; }
+  memset(best, 0xFF, BENCH_MAX_FRAMES*sizeof(uint64_t));
+  fflush(stdout);
+  for(uint8_t run = 1; run < BENCH_CPU_RUNS; run++){ //One at a time, so that they do not slow each other down
+    pid_t pid = fork();
+    if(pid == 0){
+      benchSuite();
+      benchFastest(best, false);
+      _exit(0);
+    }
+    int status;
+    if((pid < 0) || (waitpid(pid, &status, 0) != pid) || !WIFEXITED(status) || (WEXITSTATUS(status) != 0)){
+      fprintf(stderr, "bench: run %u failed\n", run);
+      munmap(best, BENCH_MAX_FRAMES*sizeof(uint64_t));
+      return 1;
+    }
+  }
+  benchSuite();
+  benchFastest(best, true);
+  munmap(best, BENCH_MAX_FRAMES*sizeof(uint64_t));
+
+  if(json){ benchJson(stdout); }
+  else{ benchCsv(stdout); }
+  return ((baseline != NULL) && (benchCompare(baseline, percent, cpuPercent) > 0)) ? 1 : 0;
+}
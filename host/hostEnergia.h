@@ -0,0 +1,608 @@
+/**
+ * @file hostEnergia.h
+ *
+ * @brief Host (Linux) implementation of the Energia API subset used by the game: clock, timers, GPIO, ADC, buzzer, RNG, serial port and String
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <ctype.h>
+#include <time.h>
+#include <vector> //STL headers used by host tools must come before the Energia min/max macros
+#include <string>
+#include <algorithm>
+#include <atomic>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> //__rdtsc() for the cycle counts of the host reports
+#endif
+
+/**
+ * Energia constants and types
+ */
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define max(a,b) ((a)>(b)?(a):(b))
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+#define highByte(w) ((uint8_t)((w) >> 8))
+#define lowByte(w) ((uint8_t)((w) & 0xff))
+
+/** Simulated clock
+ *
+ * Host time only moves when the game spends it: delay(), pin and ADC reads and bytes pushed to the display.
+ * This makes every run deterministic and lets the harness measure time as the LaunchPad would spend it.
+ *
+ * 1. hostNowNs --> current simulated time in nanoseconds
+ * 2. hostDeadlineNs --> when reached, HostStop is thrown to end the run (0 = no deadline)
+ * 3. hostTickHook --> harness callback run after every advance, used to script inputs
+ * 4. Clock callbacks --> fired inside hostAdvance at their due time, as the RTOS would preempt the running code;
+ *    peripheral interrupts raised with hostIrqRaise (a DMA transfer ending) fire the same way, to the nanosecond
+ * 5. hostSleepNs --> time spent in delay() and sleepUntilWake() outside clock callbacks, the rest is busy time;
+ *    delayMicroseconds() busy-waits, as it does on the LaunchPad
+ * 6. hostDelayHook --> harness callback run when delay() or sleepUntilWake() is called, used to find where polling loops go to sleep
+ *
+ */
+#define HOST_NUM_PINS 64
+#define HOST_DIGITALREAD_NS 250 //Cost of a digitalRead on the LaunchPad
+#define HOST_ANALOGREAD_NS 3000 //Cost of a single blocking 12-bit conversion
+
+#define HOST_CLOCK_TICK_NS 1000000 //RTOS clock tick: callbacks fire on tick boundaries
+#define HOST_CLOCK_ISR_NS 2000 //Cost of entering and leaving a clock callback
+#define HOST_MAX_CLOCKS 8
+#define HOST_MAX_IRQS 2 //Peripheral interrupt lines
+#define HOST_IRQ_DMA 0
+
+struct HostStop{};
+
+uint64_t hostNowNs = 0;
+uint64_t hostDeadlineNs = 0;
+void (*hostTickHook)(void) = NULL;
+void (*hostDelayHook)(void) = NULL;
+bool hostInTickHook = false;
+bool hostInClock = false;
+bool hostInterruptsOff = false; //noInterrupts() holds the callbacks until interrupts()
+uint32_t hostClockCalls = 0; //Clock callbacks fired
+uint64_t hostClockNs = 0; //Simulated time spent in clock callbacks
+uint64_t hostSleepNs = 0; //Simulated time spent sleeping
+uint32_t hostSleepCalls = 0; //delay() and sleepUntilWake() calls: each one ends with a wake-up
+
+/** Host CPU clock
+ *
+ * The simulated clock only moves on bus and peripheral time, so it cannot see what computing costs. These count the
+ * real time the host spends running the sketch:
+ * 1. hostSeconds --> monotonic host time
+ * 2. hostCpuNs --> host nanoseconds spent running the sketch: the clock stops in simulated sleeps and harness hooks
+ *    (HostCpuScope(false)) and runs again in the callbacks and interrupts they let fire (HostCpuScope(true))
+ * 3. hostCycles --> the TSC (nanoseconds where there is none), for the short loops of the host reports
+ * 4. hostRunHook --> run a harness hook with the CPU clock stopped and its heap allocations left out
+ *
+ */
+double hostSeconds(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+uint64_t hostRealNs(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+bool hostCpuRunning = true;
+uint64_t hostCpuStoppedNs = 0; //Real time spent with the clock stopped
+uint64_t hostCpuStopNs = 0; //When it was stopped
+
+uint64_t hostCpuNs(){ return (hostCpuRunning ? hostRealNs() : hostCpuStopNs) - hostCpuStoppedNs; }
+
+bool hostCpuRun(bool run){ //Returns the previous state
+  bool was = hostCpuRunning;
+  if(run == was){ return was; }
+  if(run){ hostCpuStoppedNs += hostRealNs() - hostCpuStopNs; }
+  else{ hostCpuStopNs = hostRealNs(); }
+  hostCpuRunning = run;
+  return was;
+}
+
+struct HostCpuScope{ //Back to the previous state however the scope is left (HostStop is thrown from sleeps)
+  bool was;
+  HostCpuScope(bool run){ was = hostCpuRun(run); }
+  ~HostCpuScope(){ hostCpuRun(was); }
+};
+
+uint64_t hostCycles(){
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return hostRealNs();
+#endif
+}
+
+/** Host heap
+ *
+ * Every malloc, calloc, realloc and operator new of the sketch is counted in hostHeapAllocs (the allocator is
+ * interposed on glibc, only operator new elsewhere). Harness hooks and the mocks' own bookkeeping hold HostHeapPause,
+ * so their allocations are not charged to the sketch.
+ *
+ */
+uint32_t hostHeapAllocs = 0;
+uint32_t hostHeapPaused = 0;
+
+struct HostHeapPause{
+  HostHeapPause(){ hostHeapPaused++; }
+  ~HostHeapPause(){ hostHeapPaused--; }
+};
+
+#ifdef __GLIBC__
+extern "C" void *__libc_malloc(size_t n);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *p, size_t n);
+
+extern "C" void *malloc(size_t n) __THROW {
+  if(hostHeapPaused == 0){ hostHeapAllocs++; }
+  return __libc_malloc(n);
+}
+
+extern "C" void *calloc(size_t n, size_t size) __THROW {
+  if(hostHeapPaused == 0){ hostHeapAllocs++; }
+  return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *p, size_t n) __THROW {
+  if(hostHeapPaused == 0){ hostHeapAllocs++; }
+  return __libc_realloc(p, n);
+}
+#else
+#include <new>
+
+void *operator new(size_t n){
+  if(hostHeapPaused == 0){ hostHeapAllocs++; }
+  void *p = malloc(n ? n : 1);
+  if(p == NULL){ throw std::bad_alloc(); }
+  return p;
+}
+
+void *operator new[](size_t n){ return operator new(n); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+#endif
+
+void hostRunHook(void (*hook)(void)){
+  HostHeapPause pause;
+  HostCpuScope cpu(false);
+  hook();
+}
+
+/** Peripheral interrupts
+ *
+ * One pending interrupt per line: hostIrqRaise(line, fn, at) runs fn in interrupt context when the simulated clock
+ * reaches at, unless noInterrupts() holds it; hostIrqSleep() sleeps until the next pending one
+ *
+ */
+typedef struct{
+  void (*fn)(void); //NULL when nothing is pending
+  uint64_t due;
+}HostIrq_t;
+
+HostIrq_t hostIrqs[HOST_MAX_IRQS];
+uint32_t hostIrqCalls = 0;
+
+void hostIrqRaise(uint8_t line, void (*fn)(void), uint64_t at){
+  if(line < HOST_MAX_IRQS){ hostIrqs[line].fn = fn; hostIrqs[line].due = at; }
+}
+
+/** Timers
+ *
+ * Galaxia Clock: one-shot (period 0) or periodic callbacks in milliseconds, started and stopped at will.
+ *
+ */
+class Clock;
+Clock *hostClocks[HOST_MAX_CLOCKS];
+uint8_t hostNumClocks = 0;
+
+class Clock{
+public:
+  Clock(){ _fn = NULL; _timeout = 0; _period = 0; _active = false; _due = 0; }
+
+  void begin(void (*fn)(void), uint32_t timeout_ms, uint32_t period_ms = 0){
+    _fn = fn;
+    _timeout = timeout_ms;
+    _period = period_ms;
+    for(uint8_t i = 0; i < hostNumClocks; i++){ if(hostClocks[i] == this){ return; } }
+    if(hostNumClocks < HOST_MAX_CLOCKS){ hostClocks[hostNumClocks++] = this; }
+  }
+
+  void start(){
+    _due = (hostNowNs/HOST_CLOCK_TICK_NS + (_timeout > 0 ? _timeout : 1))*HOST_CLOCK_TICK_NS;
+    _active = true;
+  }
+
+  void stop(){ _active = false; }
+  void setTimeout(uint32_t timeout_ms){ _timeout = timeout_ms; }
+  void setPeriod(uint32_t period_ms){ _period = period_ms; }
+
+  bool hostDue(uint64_t until){ return _active && (_due <= until); }
+  uint64_t hostDueNs(){ return _due; }
+
+  void hostFire(){
+    _active = (_period > 0);
+    _due += (uint64_t)_period*HOST_CLOCK_TICK_NS;
+    _fn();
+  }
+
+private:
+  void (*_fn)(void);
+  uint32_t _timeout;
+  uint32_t _period;
+  bool _active;
+  uint64_t _due;
+};
+
+void hostRunClocks(uint64_t until){ //Fire, in time order, every callback and interrupt due before until
+  if(hostInterruptsOff){ return; }
+  hostInClock = true;
+  while(1){
+    Clock *next = NULL;
+    for(uint8_t i = 0; i < hostNumClocks; i++){
+      if(hostClocks[i]->hostDue(until) && ((next == NULL) || (hostClocks[i]->hostDueNs() < next->hostDueNs()))){ next = hostClocks[i]; }
+    }
+    int8_t irq = -1;
+    for(uint8_t i = 0; i < HOST_MAX_IRQS; i++){
+      if((hostIrqs[i].fn != NULL) && (hostIrqs[i].due <= until) && ((irq < 0) || (hostIrqs[i].due < hostIrqs[irq].due))){ irq = i; }
+    }
+    if((irq >= 0) && ((next == NULL) || (hostIrqs[irq].due < next->hostDueNs()))){
+      if(hostIrqs[irq].due > hostNowNs){ hostNowNs = hostIrqs[irq].due; }
+      void (*fn)(void) = hostIrqs[irq].fn;
+      hostIrqs[irq].fn = NULL; //The handler may raise the line again
+      hostIrqCalls++;
+      hostClockNs += HOST_CLOCK_ISR_NS;
+      hostNowNs += HOST_CLOCK_ISR_NS;
+      {
+        HostCpuScope cpu(true);
+        fn();
+      }
+      continue;
+    }
+    if(next == NULL){ break; }
+    if(next->hostDueNs() > hostNowNs){ hostNowNs = next->hostDueNs(); }
+    {
+      HostCpuScope cpu(true);
+      next->hostFire();
+    }
+    hostClockCalls++;
+    hostClockNs += HOST_CLOCK_ISR_NS;
+    hostNowNs += HOST_CLOCK_ISR_NS;
+  }
+  hostInClock = false;
+}
+
+void hostAdvance(uint64_t ns){
+  if(hostInClock){ hostNowNs += ns; hostClockNs += ns; return; } //Time spent inside a callback
+  uint64_t until = hostNowNs + ns;
+  hostRunClocks(until);
+  if(hostNowNs < until){ hostNowNs = until; }
+  if(hostTickHook != NULL && !hostInTickHook){
+    hostInTickHook = true;
+    hostRunHook(hostTickHook);
+    hostInTickHook = false;
+  }
+  if(hostDeadlineNs != 0 && hostNowNs >= hostDeadlineNs){ throw HostStop(); }
+}
+
+void hostRunPinIsrs();
+
+void noInterrupts(){ hostInterruptsOff = true; }
+void interrupts(){ hostInterruptsOff = false; hostRunPinIsrs(); }
+
+uint32_t millis(){ return (uint32_t)(hostNowNs/1000000); }
+uint32_t micros(){ return (uint32_t)(hostNowNs/1000); }
+
+void hostSleep(uint64_t ns){
+  uint64_t t0 = hostNowNs, c0 = hostClockNs;
+  {
+    HostCpuScope cpu(false);
+    hostAdvance(ns);
+  }
+  hostSleepNs += (hostNowNs - t0) - (hostClockNs - c0);
+}
+
+void hostIrqSleep(){ //Until the next pending interrupt, at most one RTOS tick
+  uint64_t until = hostNowNs + HOST_CLOCK_TICK_NS;
+  for(uint8_t i = 0; i < HOST_MAX_IRQS; i++){ if((hostIrqs[i].fn != NULL) && (hostIrqs[i].due < until)){ until = max(hostIrqs[i].due, hostNowNs); } }
+  hostSleep(until - hostNowNs);
+}
+
+void delay(uint32_t ms){
+  if(hostDelayHook != NULL){ hostRunHook(hostDelayHook); }
+  hostSleepCalls++;
+  for(uint32_t i = 0; i < ms; i++){ hostSleep(1000000); } //1 ms steps so scripted inputs keep their resolution
+}
+
+void delayMicroseconds(uint32_t us){ hostAdvance((uint64_t)us*1000); }
+
+/** GPIO and ADC
+ *
+ * Pins idle HIGH (buttons are active LOW with pull-ups) and analog inputs idle at mid-scale.
+ * The harness drives them through hostSetPin() and hostAnalogValue[]. hostSetPin() runs the handler
+ * attached to the pin on a matching edge, right away or as soon as interrupts are enabled again.
+ * hostAnalogLoad() replays a recorded sample file instead: every line is "time_ms value value ..." with
+ * one 12-bit value per pin, '#' starts a comment, and the recording loops when it ends.
+ *
+ */
+uint8_t hostPinLevel[HOST_NUM_PINS];
+uint8_t hostPinMode[HOST_NUM_PINS];
+uint16_t hostAnalogValue[HOST_NUM_PINS];
+uint8_t hostAnalogBits = 10;
+uint32_t hostDigitalReads = 0;
+uint32_t hostAnalogReads = 0;
+void (*hostPinIsr[HOST_NUM_PINS])(void);
+uint8_t hostPinIsrMode[HOST_NUM_PINS];
+bool hostPinIsrPending[HOST_NUM_PINS];
+uint32_t hostPinIsrCalls = 0;
+
+void hostResetPins(){
+  for(int i = 0; i < HOST_NUM_PINS; i++){
+    hostPinLevel[i] = HIGH;
+    hostPinMode[i] = INPUT;
+    hostAnalogValue[i] = 2048;
+    hostPinIsr[i] = NULL;
+    hostPinIsrPending[i] = false;
+  }
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode){
+  if(pin < HOST_NUM_PINS){ hostPinIsr[pin] = isr; hostPinIsrMode[pin] = mode; }
+}
+
+void detachInterrupt(uint8_t pin){ if(pin < HOST_NUM_PINS){ hostPinIsr[pin] = NULL; } }
+
+void hostRunPinIsrs(){
+  if(hostInterruptsOff || hostInClock){ return; }
+  for(int i = 0; i < HOST_NUM_PINS; i++){
+    if(!hostPinIsrPending[i]){ continue; }
+    hostPinIsrPending[i] = false;
+    hostInClock = true; //Same context as a clock callback: time spent is charged to interrupts
+    hostPinIsrCalls++;
+    hostClockNs += HOST_CLOCK_ISR_NS;
+    hostNowNs += HOST_CLOCK_ISR_NS;
+    {
+      HostCpuScope cpu(true);
+      hostPinIsr[i]();
+    }
+    hostInClock = false;
+  }
+}
+
+void hostSetPin(uint8_t pin, uint8_t level){
+  if((pin >= HOST_NUM_PINS) || (hostPinLevel[pin] == level)){ return; }
+  hostPinLevel[pin] = level;
+  if(hostPinIsr[pin] == NULL){ return; }
+  uint8_t mode = hostPinIsrMode[pin];
+  if((mode == CHANGE) || ((mode == FALLING) && (level == LOW)) || ((mode == RISING) && (level == HIGH))){
+    hostPinIsrPending[pin] = true;
+    hostRunPinIsrs();
+  }
+}
+
+void pinMode(uint8_t pin, uint8_t mode){ if(pin < HOST_NUM_PINS){ hostPinMode[pin] = mode; } }
+
+void digitalWrite(uint8_t pin, uint8_t value){ if(pin < HOST_NUM_PINS){ hostPinLevel[pin] = value; } }
+
+int digitalRead(uint8_t pin){
+  hostDigitalReads++;
+  hostAdvance(HOST_DIGITALREAD_NS);
+  return (pin < HOST_NUM_PINS) ? hostPinLevel[pin] : LOW;
+}
+
+void analogReadResolution(int bits){ hostAnalogBits = bits; }
+
+#define HOST_PLAYBACK_PINS 8
+
+uint8_t hostPlaybackPins[HOST_PLAYBACK_PINS];
+uint8_t hostPlaybackNumPins = 0;
+std::vector<uint32_t> hostPlaybackMs; //Time of every row
+std::vector<uint16_t> hostPlaybackValues; //hostPlaybackNumPins values per row
+size_t hostPlaybackRow = 0;
+uint64_t hostPlaybackStartNs = 0;
+
+bool hostAnalogLoad(FILE *f, const uint8_t *pins, uint8_t n){
+  if(f == NULL){ return false; }
+  hostPlaybackMs.clear();
+  hostPlaybackValues.clear();
+  char line[256];
+  while(fgets(line, sizeof(line), f) != NULL){
+    char *p = line;
+    while(isspace(*p)){ p++; }
+    if((*p == '#') || (*p == 0)){ continue; }
+    hostPlaybackMs.push_back(strtoul(p, &p, 10));
+    for(uint8_t i = 0; i < n; i++){ hostPlaybackValues.push_back(strtoul(p, &p, 10) & 0x0FFF); }
+  }
+  hostPlaybackNumPins = min(n, HOST_PLAYBACK_PINS);
+  memcpy(hostPlaybackPins, pins, hostPlaybackNumPins);
+  hostPlaybackRow = 0;
+  hostPlaybackStartNs = hostNowNs;
+  return !hostPlaybackMs.empty();
+}
+
+void hostAnalogPlayback(){ //Apply the row recorded at the current time
+  if(hostPlaybackMs.empty()){ return; }
+  uint64_t length = (uint64_t)hostPlaybackMs.back() + 1;
+  uint32_t t = ((hostNowNs - hostPlaybackStartNs)/1000000) % length;
+  if(t < hostPlaybackMs[hostPlaybackRow]){ hostPlaybackRow = 0; } //Looped
+  while((hostPlaybackRow+1 < hostPlaybackMs.size()) && (hostPlaybackMs[hostPlaybackRow+1] <= t)){ hostPlaybackRow++; }
+  for(uint8_t i = 0; i < hostPlaybackNumPins; i++){
+    hostAnalogValue[hostPlaybackPins[i]] = hostPlaybackValues[hostPlaybackRow*hostPlaybackNumPins + i];
+  }
+}
+
+uint16_t analogRead(uint8_t pin){
+  hostAnalogReads++;
+  hostAdvance(HOST_ANALOGREAD_NS);
+  hostAnalogPlayback();
+  if(pin >= HOST_NUM_PINS){ return 0; }
+  return hostAnalogValue[pin] >> (12-hostAnalogBits); //hostAnalogValue[] is always on 12 bits
+}
+
+/** Buzzer
+ *
+ * Tones are not played, only counted and logged with their start time.
+ *
+ */
+typedef struct{
+  uint64_t ns; //Start time
+  uint16_t frequency; //0 for noTone
+  uint32_t duration; //ms, 0 = until noTone
+}HostTone_t;
+
+uint32_t hostToneCount = 0;
+uint32_t hostToneFrequency = 0;
+std::vector<HostTone_t> hostToneLog;
+
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration = 0){
+  HostTone_t t = {hostNowNs, (uint16_t)frequency, (uint32_t)duration};
+  HostHeapPause pause;
+  hostToneLog.push_back(t);
+  hostToneCount++;
+  hostToneFrequency = frequency;
+}
+
+void noTone(uint8_t pin){
+  HostTone_t t = {hostNowNs, 0, 0};
+  HostHeapPause pause;
+  hostToneLog.push_back(t);
+  hostToneFrequency = 0;
+}
+
+/** RNG
+ *
+ * Local LCG so that a seed gives the same sequence on every host, independently from libc.
+ *
+ */
+uint32_t hostRandomState = 1;
+
+void randomSeed(unsigned long seed){ if(seed != 0){ hostRandomState = seed; } }
+
+long random(long howbig){
+  if(howbig == 0){ return 0; }
+  hostRandomState = hostRandomState*1103515245u + 12345u;
+  return (long)((hostRandomState >> 1) % (uint32_t)howbig);
+}
+
+long random(long howsmall, long howbig){
+  if(howsmall >= howbig){ return howsmall; }
+  return random(howbig-howsmall) + howsmall;
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max){
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+/** Serial port
+ *
+ * Output goes to hostSerialOut (discarded when NULL), input is read from hostSerialIn.
+ * Bytes are charged at the UART rate, as the blocking Energia Serial would.
+ *
+ */
+#define HOST_SERIAL_NS_PER_BYTE 86806 //115200 baud, 10 bits per byte
+
+FILE *hostSerialOut = NULL;
+std::string hostSerialIn;
+
+class HostSerial{
+public:
+  void begin(unsigned long baud){}
+  int available(){ return hostSerialIn.size(); }
+  int read(){
+    if(hostSerialIn.empty()){ return -1; }
+    int c = (uint8_t)hostSerialIn[0];
+    hostSerialIn.erase(0, 1);
+    return c;
+  }
+  void print(const char *s){ _write(s); }
+  void print(char c){ char s[2] = {c, 0}; _write(s); }
+  void print(int n){ print((long)n); }
+  void print(unsigned int n){ print((unsigned long)n); }
+  void print(long n){ char s[24]; snprintf(s, sizeof(s), "%ld", n); _write(s); }
+  void print(unsigned long n){ char s[24]; snprintf(s, sizeof(s), "%lu", n); _write(s); }
+  void println(){ _write("\r\n"); }
+  template<typename T> void println(T v){ print(v); println(); }
+
+private:
+  void _write(const char *s){
+    size_t n = strlen(s);
+    HostHeapPause pause; //stdio buffers
+    if(hostSerialOut != NULL){ fputs(s, hostSerialOut); }
+    hostAdvance((uint64_t)n*HOST_SERIAL_NS_PER_BYTE);
+  }
+};
+
+HostSerial Serial;
+
+/** String
+ *
+ * Minimal Arduino String: every buffer is taken from the heap, and so counted in hostHeapAllocs,
+ * exactly as the device String would do.
+ *
+ */
+
+class String{
+public:
+  String(const char *s = ""){ _set(s, strlen(s)); }
+  String(const String &s){ _set(s._buffer, s._length); }
+  String(int n){ _setNumber(n); }
+  String(unsigned int n){ _setNumber(n); }
+  String(long n){ _setNumber(n); }
+  String(unsigned long n){ _setNumber((long)n); }
+  String(unsigned char n){ _setNumber(n); }
+  ~String(){ free(_buffer); }
+
+  String &operator=(const String &s){
+    if(this != &s){ free(_buffer); _set(s._buffer, s._length); }
+    return *this;
+  }
+
+  friend String operator+(const String &a, const String &b){
+    char *buffer = (char *)malloc(a._length+b._length+1);
+    memcpy(buffer, a._buffer, a._length);
+    memcpy(buffer+a._length, b._buffer, b._length+1);
+    return String(buffer, a._length+b._length);
+  }
+
+  unsigned int length() const { return _length; }
+  char charAt(unsigned int i) const { return (i < _length) ? _buffer[i] : 0; }
+  const char *c_str() const { return _buffer; }
+
+private:
+  char *_buffer;
+  unsigned int _length;
+
+  String(char *buffer, unsigned int length) : _buffer(buffer), _length(length) {} //Adopts a buffer already taken
+
+  void _set(const char *s, unsigned int n){
+    _buffer = (char *)malloc(n+1);
+    memcpy(_buffer, s, n);
+    _buffer[n] = 0;
+    _length = n;
+  }
+
+  void _setNumber(long n){
+    char tmp[12];
+    snprintf(tmp, sizeof(tmp), "%ld", n);
+    _set(tmp, strlen(tmp));
+  }
+};
@@ -0,0 +1,81 @@
+/**
+ * @file hostFlash.h
+ *
+ * @brief In-memory mock of the flash sectors reserved for saved data: NOR semantics, erase and program latencies, operation counters
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/** Cost model
+ *
+ * Figures of the MSP432P401R flash controller at 48 MHz: a sector erase blocks the CPU for ~12 ms, a program
+ * takes ~45 us per 32-bit word (program and verify pulses), a read costs the wait states of one access per word.
+ * The time is charged to the simulated clock, so an operation in the frame loop shows up as a missed deadline.
+ *
+ */
+#define HOST_FLASH_ERASE_NS 12000000
+#define HOST_FLASH_WORD_NS 45000
+#define HOST_FLASH_READ_NS 63 //3 wait states per 32-bit word
+
+typedef struct{
+  uint32_t erases; //Sector erases
+  uint32_t programs; //flashProgram calls
+  uint32_t bytesProgrammed;
+  uint32_t reads; //flashRead calls
+  uint32_t sectorErases[FLASH_STORE_SECTORS]; //Wear of every sector
+}HostFlashStats_t;
+
+uint8_t hostFlash[FLASH_STORE_SECTORS][FLASH_SECTOR_BYTES];
+HostFlashStats_t hostFlashStats;
+int32_t hostFlashFailAt = -1; //Erases and programs before power is lost half way through one, -1 never
+bool hostFlashTorn = false; //Set by the interrupted operation: the harness must power cycle
+
+/** Power loss
+ *
+ * Every erase or program decrements hostFlashFailAt; the one that finds it at 0 only does its first half
+ * (first half of the sector erased, first half of the bytes programmed) and sets hostFlashTorn.
+ *
+ */
+uint32_t hostFlashCut(uint32_t n){
+  if(hostFlashFailAt < 0){ return n; }
+  if(hostFlashFailAt-- > 0){ return n; }
+  hostFlashTorn = true;
+  return n/2;
+}
+
+void hostFlashReset(){ //Factory state: every sector erased
+  memset(hostFlash, 0xFF, sizeof(hostFlash));
+  memset(&hostFlashStats, 0, sizeof(hostFlashStats));
+}
+
+uint32_t hostFlashOps(){
+  return hostFlashStats.erases + hostFlashStats.programs;
+}
+
+void flashEraseSector(uint8_t s){
+  memset(hostFlash[s % FLASH_STORE_SECTORS], 0xFF, hostFlashCut(FLASH_SECTOR_BYTES));
+  hostFlashStats.erases++;
+  hostFlashStats.sectorErases[s % FLASH_STORE_SECTORS]++;
+  hostAdvance(HOST_FLASH_ERASE_NS);
+}
+
+bool flashProgram(uint8_t s, uint16_t offset, const void *data, uint16_t n){
+  if((s >= FLASH_STORE_SECTORS) || (offset + n > FLASH_SECTOR_BYTES)){ return false; }
+  n = hostFlashCut(n);
+  const uint8_t *d = (const uint8_t *)data;
+  bool ok = true;
+  for(uint16_t i = 0; i < n; i++){
+    hostFlash[s][offset+i] &= d[i]; //Programming only clears bits
+    ok = ok && (hostFlash[s][offset+i] == d[i]);
+  }
+  hostFlashStats.programs++;
+  hostFlashStats.bytesProgrammed += n;
+  hostAdvance((uint64_t)((n+3)/4)*HOST_FLASH_WORD_NS);
+  return ok;
+}
+
+void flashRead(uint8_t s, uint16_t offset, void *data, uint16_t n){
+  memcpy(data, &hostFlash[s % FLASH_STORE_SECTORS][offset], n);
+  hostFlashStats.reads++;
+  hostAdvance((uint64_t)((n+3)/4)*HOST_FLASH_READ_NS);
+}
@@ -0,0 +1,942 @@
+/**
+ * @file hostMain.cpp
+ *
+ * @brief Headless Linux runner: plays the unchanged FSM with scripted inputs on the mock screen and prints per-state counters
+ *
+ * Build and run from the sketch folder:
+ *   g++ -std=c++11 -O2 host/hostMain.cpp -o racingGameHost
+ *   ./racingGameHost [games] [seed]
+ *   ./racingGameHost profile [games] [seed]
+ *   ./racingGameHost logo
+ *   ./racingGameHost bands
+ *   ./racingGameHost music
+ *   ./racingGameHost adc [samples]
+ *   ./racingGameHost menu
+ *   ./racingGameHost blocks
+ *   ./racingGameHost sweep
+ *   ./racingGameHost steps
+ *   ./racingGameHost latency
+ *   ./racingGameHost record <file> [games] [seed]
+ *   ./racingGameHost replay <file> [fast]
+ *   ./racingGameHost bench [csv|json] [baseline.csv [percent [cpu_percent]]]
+ *   ./racingGameHost palette
+ *   ./racingGameHost store [sessions] [seed]
+ *   ./racingGameHost tune [games] [workers]
+ *   ./racingGameHost tune search <rookie|champion|legend> <median_s> [games] [workers]
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+#define HOST_BUILD
+#ifndef PROF_GAME_OVER_DUMP
+#define PROF_GAME_OVER_DUMP 1 //The profile report reads the dump of every game
+#endif
+#ifndef BLOCK_POOL_SIZE
+#define BLOCK_POOL_SIZE 512 //Largest block count of the blocks report
+#endif
+#ifndef BAND_HEIGHT
+#define BAND_HEIGHT 16 //Tallest band compared by the bands report
+#endif
+#include "../RacingGame.ino"
+#include "../imageBlit.h" //Only the logo report still blits raw images: the device build leaves it out
+#include "assetEncoder.h"
+#include "hostBench.h"
+#include "hostTuner.h"
+
+/** Input script
+ *
+ * 1. Menus, command pages and game over --> S2 is pressed 150 ms after the page is entered, bouncing for SCRIPT_BOUNCE_US
+ * 2. Game --> joystick sweeps left/right (and slightly up/down, the car is redrawn only when both axes move)
+ *
+ */
+#define SCRIPT_PRESS_MS 150
+#define SCRIPT_BOUNCE_US 2000 //Contacts bounce every 250 us right after the press
+
+State_t scriptState = STATE_INIT;
+uint64_t scriptEntryNs = 0;
+uint16_t scriptGames = 0; //Games to be played before stopping
+uint16_t playedGames = 0;
+
+const char *stateNames[NUM_STATES] = {"INIT", "CMD_MENU", "SEL_CAR", "SEL_DIFF", "SEL_MODE", "CMD_GAME", "INIT_GAME", "GAME", "GAME_OVER"};
+
+void scriptTick(){
+  if(current_state != scriptState){ //New page: release everything
+    scriptState = current_state;
+    scriptEntryNs = hostNowNs;
+    hostSetPin(buttonOne, HIGH);
+    hostSetPin(buttonTwo, HIGH);
+    if(scriptState == STATE_GAME_OVER){
+      playedGames++;
+      if(playedGames >= scriptGames){ hostDeadlineNs = hostNowNs + 100000000; } //Stop once the last game over page is drawn
+    }
+  }
+  uint64_t elapsedUs = (hostNowNs - scriptEntryNs)/1000;
+  uint64_t elapsedMs = elapsedUs/1000;
+
+  if(scriptState == STATE_GAME){
+    double t = hostNowNs/1e9;
+    hostAnalogValue[joystickX] = 2048 + (int)(1800*sin(t*1.3));
+    hostAnalogValue[joystickY] = 2048 + (int)(300*sin(t*7.1));
+  }
+  else if((scriptState != STATE_INIT) && (scriptState != STATE_INIT_GAME) && (elapsedMs >= SCRIPT_PRESS_MS)){
+    uint64_t pressUs = elapsedUs - SCRIPT_PRESS_MS*1000;
+    bool bounce = (pressUs < SCRIPT_BOUNCE_US) && ((pressUs/250) % 2 == 1);
+    hostSetPin(buttonTwo, bounce ? HIGH : LOW);
+  }
+}
+
+/** Per-state report
+ *
+ * Counters are sampled around each loop() call and charged to the state that was running. The active column is the
+ * fraction of the state time the CPU was not asleep, wake/s the wake-ups per second: interrupts, Clock callbacks and
+ * ends of delay() or sleepUntilWake().
+ *
+ */
+typedef struct{
+  uint64_t nowNs, sleepNs;
+  HostScreenStats_t screen;
+  uint32_t heapAllocs, flashOps, wakes;
+}HostSnapshot_t;
+
+typedef struct{
+  uint32_t entries;
+  uint64_t ns;
+  HostScreenStats_t screen;
+  uint32_t heapAllocs;
+  uint32_t flashOps; //Flash erases and programs
+  uint64_t sleepNs;
+  uint32_t wakes; //Pin interrupts, Clock callbacks and ends of sleeps
+}HostStateStats_t;
+
+HostStateStats_t stateStats[NUM_STATES];
+
+HostSnapshot_t hostSnapshot(){
+  HostSnapshot_t s = {hostNowNs, hostSleepNs, hostScreenStats(), hostHeapAllocs, hostFlashOps(), hostClockCalls + hostPinIsrCalls + hostSleepCalls};
+  return s;
+}
+
+void chargeState(State_t state, const HostSnapshot_t &from){
+  HostStateStats_t *st = &stateStats[state];
+  HostScreenStats_t s0 = from.screen;
+  st->entries++;
+  st->ns += hostNowNs - from.nowNs;
+  st->sleepNs += hostSleepNs - from.sleepNs;
+  st->wakes += hostClockCalls + hostPinIsrCalls + hostSleepCalls - from.wakes;
+  st->screen.pointCalls += myScreen.stats.pointCalls - s0.pointCalls;
+  st->screen.rectangleCalls += myScreen.stats.rectangleCalls - s0.rectangleCalls;
+  st->screen.textCalls += hostScreenStats().textCalls - s0.textCalls;
+  st->screen.clearCalls += myScreen.stats.clearCalls - s0.clearCalls;
+  st->screen.windows += myScreen.stats.windows - s0.windows;
+  st->screen.pixels += myScreen.stats.pixels - s0.pixels;
+  st->screen.bytes += myScreen.stats.bytes - s0.bytes;
+  st->heapAllocs += hostHeapAllocs - from.heapAllocs;
+  st->flashOps += hostFlashOps() - from.flashOps;
+}
+
+void printReport(){
+  printf("%-10s %7s %10s %7s %7s %8s %8s %8s %6s %9s %10s %11s %6s %5s\n", "state", "entries", "time_ms", "active", "wake/s", "point", "rect", "text", "clear", "windows", "pixels", "bytes", "allocs", "flash");
+  for(int i = 0; i < NUM_STATES; i++){
+    HostStateStats_t *st = &stateStats[i];
+    printf("%-10s %7u %10.1f %6.1f%% %7.1f %8u %8u %8u %6u %9u %10u %11u %6u %5u\n", stateNames[i], st->entries, st->ns/1e6,
+           st->ns ? 100.0*(st->ns - st->sleepNs)/st->ns : 0.0, st->ns ? st->wakes*1e9/st->ns : 0.0,
+           st->screen.pointCalls, st->screen.rectangleCalls, st->screen.textCalls, st->screen.clearCalls,
+           st->screen.windows, st->screen.pixels, st->screen.bytes, st->heapAllocs, st->flashOps);
+  }
+  printf("games %u, score %u, record %u, simulated time %.1f s\n", playedGames, score, record, hostNowNs/1e9);
+  printf("score store: boot scan %u us, %u records appended, %u compactions, %u flash operations (%u in GAME)\n", storeStats.bootUs,
+         storeStats.appends, storeStats.compactions, hostFlashOps(), stateStats[STATE_GAME].flashOps);
+  printf("last game at %d Hz: %u frames, %u steps (%u dropped), work mean %.2f ms max %.2f ms, %u overruns\n", FRAME_RATE_HZ,
+         gameFrames.frames, gameFrames.steps, gameFrames.dropped, gameFrames.frames ? gameFrames.total_work_us/1e3/gameFrames.frames : 0.0,
+         gameFrames.max_work_us/1e3, gameFrames.overruns);
+  printf("buttons: %u edges, %u events (%u dropped), latency mean %.2f ms max %.2f ms\n", buttonStats.edges, buttonStats.events,
+         buttonStats.dropped, buttonStats.events ? buttonStats.total_latency_us/1e3/buttonStats.events : 0.0, buttonStats.max_latency_us/1e3);
+  printf("compositor: %u flushes, %u damaged regions, %u windows, %u pixels (%.1f windows and %.0f SPI bytes per flush)\n",
+         compStats.frames, compStats.damaged, compStats.windows, compStats.pixels,
+         compStats.frames ? (double)compStats.windows/compStats.frames : 0.0,
+         compStats.frames ? (compStats.windows*11.0 + compStats.pixels*2.0)/compStats.frames : 0.0);
+  if(bandStats.frames > 0){
+    printf("bands of %u rows: %u frames, %u bands, %u pixels (%.1f windows and %.0f SPI bytes per frame)\n", BAND_HEIGHT,
+           bandStats.frames, bandStats.bands, bandStats.pixels, (double)bandStats.bands/bandStats.frames,
+           (bandStats.bands*11.0 + bandStats.pixels*2.0)/bandStats.frames);
+  }
+  if(displayStats.submits > 0){ //Transfer time the CPU did not wait for ran under the next frames
+    printf("display queue: %u submits (%u forced by a full queue), largest %u of %u bytes, %u DMA transfers, bus %.1f ms, "
+           "CPU waited %.1f ms in %u fences (%.0f%% of the transfer time overlapped)\n", displayStats.submits, displayStats.overflows,
+           displayStats.maxBytes, DISPLAY_QUEUE_BYTES, displayStats.transfers, hostDmaNs/1e6, displayStats.waitUs/1e3, displayStats.waits,
+           hostDmaNs ? 100.0*(1.0 - displayStats.waitUs*1e3/hostDmaNs) : 0.0);
+  }
+  if(latencyStats.frames > 0){
+    printf("input latency (last game, %s): %u frames, mean %.2f ms, p50 %.2f ms, p99 %.2f ms, max %.2f ms\n", lateLatch ? "late latch" : "sampled at frame start",
+           latencyStats.frames, latencyStats.total_us/1e3/latencyStats.frames, latencyPercentile(0.5)/1e3, latencyPercentile(0.99)/1e3,
+           latencyStats.max_us/1e3);
+  }
+}
+
+/** Logo report
+ *
+ * Draw the logo point by point, as displayLogo() originally did, then with the raw burst blit and
+ * with the compressed asset (whole logo and 16-row chunks), and compare bus traffic and resulting pixels.
+ * Then encode the logo with every codec and report flash size and decode throughput.
+ *
+ */
+uint16_t logoRaw[x_logo*y_logo]; //Decoded logo, row after row
+
+void measureLogo(const char *name, uint8_t mode, uint16_t *reference){
+  const Image_t rawImage = {x_logo, y_logo, false, logoRaw};
+  memset(myScreen.frame, 0, sizeof(myScreen.frame));
+  HostScreenStats_t s0 = myScreen.stats;
+  uint64_t t0 = hostNowNs;
+
+  if(mode == 0){
+    for(uint16_t i = 0; i < x_logo; i++){
+      for(uint16_t j = 0; j < y_logo; j++){ myScreen.point(i, j, logoRaw[j*x_logo + i]); }
+    }
+  }
+  else if(mode == 1){ blitImage(&rawImage, 0, 0); }
+  else{ displayLogo(mode == 2 ? 0 : 16); }
+
+  printf("%-14s %9u %9u %9u %9.1f %s\n", name, myScreen.stats.windows - s0.windows, myScreen.stats.pixels - s0.pixels,
+         myScreen.stats.bytes - s0.bytes, (hostNowNs - t0)/1e6,
+         (mode == 0) ? "reference" : (memcmp(reference, myScreen.frame, sizeof(myScreen.frame)) == 0 ? "identical" : "DIFFERENT"));
+  if(mode == 0){ memcpy(reference, myScreen.frame, sizeof(myScreen.frame)); }
+}
+
+void reportLogo(){
+  static uint16_t reference[HOST_SCREEN_SIZE*HOST_SCREEN_SIZE];
+  AssetDecoder_t dec;
+  assetBegin(&dec, &logoAsset, 0, 0);
+  assetDecode(&dec, logoRaw, x_logo*y_logo);
+
+  printf("%-14s %9s %9s %9s %9s %s\n", "logo", "windows", "pixels", "bytes", "time_ms", "image");
+  measureLogo("point", 0, reference);
+  measureLogo("raw blit", 1, reference);
+  measureLogo("asset", 2, reference);
+  measureLogo("asset 16 rows", 3, reference);
+
+  std::vector<uint16_t> pixels(logoRaw, logoRaw + x_logo*y_logo);
+  printf("\n%-14s %9s %14s\n", "codec", "flash", "host_px_per_ms");
+  for(int k = 0; k < NUM_CODECS; k++){
+    EncodedAsset_t e = encodeAsset(pixels, k);
+    if(!e.valid){ continue; }
+    Asset_t a = assetView(e, x_logo, y_logo);
+    const int repeat = 200;
+    double t0 = hostSeconds();
+    for(int r = 0; r < repeat; r++){
+      assetBegin(&dec, &a, 0, 0);
+      while(assetDecode(&dec, assetChunk, ASSET_CHUNK) > 0);
+    }
+    double ms = (hostSeconds() - t0)*1e3;
+    printf("%-14s %9u %14.0f\n", codecNames[k], assetFlashSize(&a), repeat*pixels.size()/ms);
+  }
+}
+
+/** Bands report
+ *
+ * Render full frames of a representative game scene (grass, every block, car and score) with the
+ * compositor and with the band renderer at several band heights, and compare bus traffic per frame,
+ * simulated panel time, host CPU time and resulting pixels.
+ *
+ */
+#define BANDS_FRAMES 100
+
+void measureBands(const char *name, uint8_t bandRows, uint16_t *reference){
+  memset(myScreen.frame, 0, sizeof(myScreen.frame));
+  HostScreenStats_t s0 = myScreen.stats;
+  uint64_t t0 = hostNowNs;
+  double c0 = hostSeconds();
+
+  for(int f = 0; f < BANDS_FRAMES; f++){
+    compositorBegin();
+    addScene();
+    if(bandRows == 0){
+      compositorDamage(0, 0, LCD_WIDTH, LCD_HEIGHT);
+      compositorFlush();
+    }
+    else{ bandFlush(true, bandRows); }
+  }
+
+  double cpu = (hostSeconds() - c0)*1e6/BANDS_FRAMES;
+  printf("%-14s %9u %9u %9u %9u %9.2f %9.1f %s\n", name, bandRows*LCD_WIDTH*2,
+         (myScreen.stats.windows - s0.windows)/BANDS_FRAMES, (myScreen.stats.bursts - s0.bursts)/BANDS_FRAMES,
+         (myScreen.stats.bytes - s0.bytes)/BANDS_FRAMES, (hostNowNs - t0)/1e6/BANDS_FRAMES, cpu,
+         (bandRows == 0) ? "reference" : (memcmp(reference, myScreen.frame, sizeof(myScreen.frame)) == 0 ? "identical" : "DIFFERENT"));
+  if(bandRows == 0){ memcpy(reference, myScreen.frame, sizeof(myScreen.frame)); }
+}
+
+void reportBands(){
+  static uint16_t reference[HOST_SCREEN_SIZE*HOST_SCREEN_SIZE];
+  randomSeed(1);
+  blockPoolReset();
+  for(int i = 0; i < 7; i++){
+    blockAlloc(random(grassWidth, LCD_WIDTH - grassWidth - blockDim), i*(LCD_HEIGHT/7), STEP_PER_TICK, colors[i]);
+  }
+  x00 = LCD_WIDTH/2;
+  y00 = LCD_HEIGHT - offset;
+  textHudReset(&scoreHud, 1, 2);
+  textHudNumber(&scoreHud, 123);
+
+  printf("%-14s %9s %9s %9s %9s %9s %9s %s\n", "full frame", "ram", "windows", "bursts", "bytes", "panel_ms", "host_us", "image");
+  measureBands("compositor", 0, reference);
+  const uint8_t heights[] = {1, 2, 4, 8, 16};
+  for(uint8_t k = 0; k < sizeof(heights); k++){
+    char name[16];
+    snprintf(name, sizeof(name), "band %u", heights[k]);
+    measureBands(name, heights[k], reference);
+  }
+}
+
+/** Scroll report
+ *
+ * Play frames of a game scene (blocks falling at a few speed levels, car weaving, score growing) with the draw functions of the game:
+ * once with the road moved by the panel scroll, once redrawing the whole road every frame as moving scenery would
+ * need without it, and scrolled again with the frames queued for the DMA (displayQueue.h). After every frame
+ * (once the queue has drained) the panel, read through the scroll, must show exactly the scene.
+ *
+ */
+#define SCROLL_FRAMES 600
+
+void measureScroll(const char *name, bool scroll, bool async){
+  randomSeed(1);
+  blockPoolReset();
+  roadFall = 0;
+  roadRows = 0;
+  stepVel = q16Mul(Q16(1), STEP_PER_TICK);
+  for(int i = 0; i < 7; i++){
+    uint16_t b = blockAlloc(random(grassWidth, LCD_WIDTH - grassWidth - blockDim), i*(LCD_HEIGHT/7), stepVel, colors[i]);
+    roadPlace(b);
+  }
+  x00 = LCD_WIDTH/2;
+  y00 = LCD_HEIGHT - offset;
+  textHudReset(&scoreHud, 1, 2);
+  memset(myScreen.frame, 0, sizeof(myScreen.frame));
+  if(scroll){ roadBegin(); }
+  else{
+    compositorScrollArea(0, 0); //No scroll area: memory rows are screen rows
+    carDrawn = carBox(x00, y00);
+  }
+  compositorBegin(); //Whole first frame, as the background of INIT_GAME would be
+  addScene();
+  compositorDamage(0, 0, LCD_WIDTH, LCD_HEIGHT);
+  compositorFlush();
+  displayAsync(async);
+
+  HostScreenStats_t s0 = myScreen.stats;
+  uint64_t t0 = hostNowNs;
+  uint32_t bad = 0;
+  for(int f = 0; f < SCROLL_FRAMES; f++){
+    stepVel = q16Mul(Q16(1 + (f*4)/SCROLL_FRAMES), STEP_PER_TICK); //Speed levels 1 to 4
+    for(uint16_t k = 0; k < blockCount; k++){ blockVel[blockActive[k]] = stepVel; }
+    roadFall += stepVel;
+    for(uint16_t k = 0; k < blockCount; k++){
+      uint16_t i = blockActive[k];
+      if(!blockFall(i, LCD_HEIGHT)){
+        score++;
+        blockMove(i, random(grassWidth, LCD_WIDTH - grassWidth - blockDim), 0);
+        roadPlace(i);
+      }
+    }
+    if(f % 3 == 0){ //The car moves only when both coordinates change
+      x00 = LCD_WIDTH/2 + (int)(30*sin(f/20.0));
+      y00 = LCD_HEIGHT - offset - 10 + (f/3) % 2;
+    }
+
+    compositorBegin();
+    textHudNumber(&scoreHud, score);
+    if(!scroll){ compositorDamage(0, ROAD_TOP, LCD_WIDTH, LCD_HEIGHT - ROAD_TOP); }
+    drawRoad();
+    drawCar();
+    drawFlush();
+    displayWait(displaySubmit());
+
+    bool same = true;
+    for(int16_t row = 0; row < LCD_HEIGHT && same; row++){
+      compositorRenderRow(row, 0, LCD_WIDTH, compLine);
+      for(int16_t c = 0; c < LCD_WIDTH; c++){ same = same && (myScreen.hostShown(c, row) == compLine[c]); }
+    }
+    if(!same){ bad++; }
+  }
+
+  HostScreenStats_t s = myScreen.stats;
+  printf("%-14s %9.1f %9.2f %9.0f %9.0f %9.2f %s\n", name, (s.windows - s0.windows)/(double)SCROLL_FRAMES,
+         (s.scrolls - s0.scrolls)/(double)SCROLL_FRAMES, (s.pixels - s0.pixels)/(double)SCROLL_FRAMES,
+         (s.bytes - s0.bytes)/(double)SCROLL_FRAMES, (hostNowNs - t0)/1e6/SCROLL_FRAMES, (bad == 0) ? "identical" : "DIFFERENT");
+  displayAsync(false);
+  if(scroll){ roadEnd(); }
+}
+
+void reportScroll(){
+#if ROAD_SCROLL
+  displayBegin();
+  printf("%-14s %9s %9s %9s %9s %9s %s\n", "per frame", "windows", "scrolls", "pixels", "bytes", "panel_ms", "image");
+  measureScroll("full redraw", false, false);
+  measureScroll("scroll", true, false);
+  measureScroll("scroll + DMA", true, true);
+#else
+  printf("built with ROAD_SCROLL 0: the road does not scroll\n");
+#endif
+}
+
+/** Music report
+ *
+ * Queue the intro and the countdown on the sequencer, draw the logo and keep the CPU busy until the
+ * music is over, then compare the logged start of every note with the song tables.
+ * The blocking playMusic() held the CPU for the whole intro; here only the callbacks are charged to the music.
+ *
+ */
+void reportMusic(){
+  const Song_t *songs[] = {&introSong, &countdownSong};
+  hostResetPins();
+  setup();
+  adcClock.stop(); //Only the music callbacks are measured
+  hostToneLog.clear();
+  uint64_t t0 = hostNowNs;
+  uint32_t calls0 = hostClockCalls;
+  uint64_t clockNs0 = hostClockNs;
+
+  musicPlay(songs[0]);
+  musicQueue(songs[1]);
+  displayLogo();
+  uint32_t frames = 1;
+  while(musicPlaying()){ //Foreground work: redraw the logo, as a busy menu would
+    displayLogo(16);
+    frames++;
+  }
+  uint64_t length = hostNowNs - t0;
+
+  printf("%-5s %9s %12s %12s %9s\n", "note", "frequency", "expected_ms", "actual_ms", "error_ms");
+  uint64_t expected = 0;
+  double maxError = 0;
+  size_t k = 0;
+  uint16_t notes = 0;
+  for(uint8_t s = 0; s < 2; s++){
+    for(uint8_t n = 0; n < songs[s]->length; n++, k++){
+      while((k < hostToneLog.size()) && (hostToneLog[k].frequency == 0)){ k++; } //noTone entries
+      if((k >= hostToneLog.size()) || (hostToneLog[k].frequency != songs[s]->notes[n])){ printf("note %u missing\n", (unsigned)k); return; }
+      double actual = (hostToneLog[k].ns - t0)/1e6;
+      double error = actual - expected;
+      maxError = max(maxError, fabs(error));
+      printf("%-5u %9u %12.3f %12.3f %9.3f\n", notes, hostToneLog[k].frequency, (double)expected, actual, error);
+      expected += 1000/songs[s]->durations[n] + songs[s]->gap;
+      notes++;
+    }
+  }
+  printf("\n%u notes in %.1f ms (expected %.1f), max start error %.3f ms\n", notes, length/1e6, (double)expected, maxError);
+  printf("%u callbacks, %.3f ms in callbacks, %.3f%% of the CPU left to the foreground (%u logo redraws)\n",
+         hostClockCalls - calls0, (hostClockNs - clockNs0)/1e6, 100.0*(1.0 - (double)(hostClockNs - clockNs0)/length), frames);
+}
+
+/** ADC report
+ *
+ * Replay a recorded joystick/accelerometer file (or a synthetic noisy sweep) and, at every game frame, read
+ * the joystick both with two blocking conversions, as the game did, and from the background sampler.
+ * Compare the conversion time spent inside the frame and the frame-to-frame jitter of the car position
+ * on the idle Y axis (in the synthetic sweep only X moves).
+ *
+ */
+#define ADC_REPORT_FRAMES 600
+
+void synthesizeSamples(FILE *f){ //Noisy 0.5 Hz sweep on joystick X, noise only on the other channels, 1 kHz
+  fprintf(f, "# time_ms joystickX joystickY xpin ypin\n");
+  for(uint32_t t = 0; t < 4000; t++){
+    int sweep = 2048 + (int)(1500*sin(2*M_PI*0.5*t/1000.0));
+    fprintf(f, "%u %d %d %d %d\n", t, sweep + (int)random(-48, 49), 2048 + (int)random(-48, 49),
+            2048 + (int)random(-48, 49), 2048 + (int)random(-48, 49));
+  }
+}
+
+void reportAdc(const char *path){
+  const uint8_t pins[ADC_CHANNELS] = {joystickX, joystickY, xpin, ypin};
+  FILE *f = (path != NULL) ? fopen(path, "r") : tmpfile();
+  if(f == NULL){ printf("cannot open %s\n", path); return; }
+  if(path == NULL){ synthesizeSamples(f); rewind(f); }
+  bool loaded = hostAnalogLoad(f, pins, ADC_CHANNELS);
+  fclose(f);
+  if(!loaded){ printf("no samples in %s\n", path); return; }
+
+  hostResetPins();
+  setup();
+  uint64_t clockNs0 = hostClockNs;
+  uint64_t blockingNs = 0, samplerNs = 0;
+  int lastRaw = -1, lastFiltered = -1;
+  double rawJitter = 0, filteredJitter = 0;
+  uint32_t rawSteps = 0, filteredSteps = 0;
+
+  for(int frame = 0; frame < ADC_REPORT_FRAMES; frame++){
+    uint64_t t0 = hostNowNs;
+    analogRead(joystickX);
+    int rawY = map(analogRead(joystickY), 0, 4096, 128, 0);
+    blockingNs += hostNowNs - t0;
+
+    t0 = hostNowNs;
+    AdcFrame_t input = adcLatest();
+    int filteredY = map(input.value[ADC_JOY_Y], 0, 4096, 128, 0);
+    samplerNs += hostNowNs - t0;
+
+    if(lastRaw >= 0){
+      rawJitter += (rawY - lastRaw)*(rawY - lastRaw);
+      filteredJitter += (filteredY - lastFiltered)*(filteredY - lastFiltered);
+      rawSteps += (rawY != lastRaw);
+      filteredSteps += (filteredY != lastFiltered);
+    }
+    lastRaw = rawY;
+    lastFiltered = filteredY;
+    delayMicroseconds(FRAME_PERIOD_US - (hostNowNs - t0)/1000);
+  }
+
+  printf("%u samples at %d Hz, %u frames at %d Hz\n", (unsigned)hostPlaybackMs.size(), 1000/ADC_PERIOD_MS, ADC_REPORT_FRAMES, FRAME_RATE_HZ);
+  printf("%-10s %16s %18s %14s %12s\n", "read", "in_frame_us", "background_us", "rms_dy_px", "y_changes");
+  printf("%-10s %16.2f %18.2f %14.2f %12u\n", "blocking", blockingNs/1e3/ADC_REPORT_FRAMES, 0.0,
+         sqrt(rawJitter/(ADC_REPORT_FRAMES-1)), rawSteps);
+  printf("%-10s %16.2f %18.2f %14.2f %12u\n", "sampler", samplerNs/1e3/ADC_REPORT_FRAMES, (hostClockNs - clockNs0)/1e3/ADC_REPORT_FRAMES,
+         sqrt(filteredJitter/(ADC_REPORT_FRAMES-1)), filteredSteps);
+  printf("sampler: %u sequences, %u conversions\n", adcStats.sequences, adcStats.conversions);
+}
+
+/** Menu report
+ *
+ * Show the car page and leave it idle, then hold the joystick down, then press S2, measuring draw calls
+ * per second in each phase and the auto-repeat rate.
+ *
+ */
+#define MENU_IDLE_MS 5000
+#define MENU_HOLD_MS 1500
+
+uint64_t menuScriptStartNs = 0;
+
+void menuScript(){
+  uint64_t ms = (hostNowNs - menuScriptStartNs)/1000000;
+  hostAnalogValue[joystickY] = ((ms >= MENU_IDLE_MS) && (ms < MENU_IDLE_MS+MENU_HOLD_MS)) ? 100 : 2048;
+  hostSetPin(buttonTwo, (ms >= MENU_IDLE_MS+MENU_HOLD_MS+200) ? LOW : HIGH);
+}
+
+void reportMenu(){
+  hostResetPins();
+  setup();
+  menuScriptStartNs = hostNowNs;
+  hostTickHook = menuScript;
+
+  HostScreenStats_t s0 = hostScreenStats();
+  uint64_t t0 = hostNowNs;
+  menuRun(&carPage, applySetting);
+  uint64_t total = hostNowNs - t0;
+
+  printf("car page: %u moves, %u rows drawn, %u text calls, %u windows in %.1f s (%.1f text calls/s)\n", menuStats.moves,
+         menuStats.rowDraws, hostScreenStats().textCalls - s0.textCalls, myScreen.stats.windows - s0.windows, total/1e9,
+         (hostScreenStats().textCalls - s0.textCalls)/(total/1e9));
+  printf("idle: %u rows redrawn without a move, auto-repeat: %u moves in %u ms of hold (%u options)\n",
+         menuStats.rowDraws - N_cars - 2*menuStats.moves, menuStats.moves, MENU_HOLD_MS, N_cars);
+}
+
+/** Blocks report
+ *
+ * Fill the pool with a growing number of falling blocks and run game frames: motion, broadphase collision
+ * against the car (compared with a linear scan of every block) and drawing. Host CPU time is per frame.
+ *
+ */
+#define BLOCKS_FRAMES 200
+
+void reportBlocks(){
+  const uint16_t counts[] = {7, 16, 32, 64, 128, 256, 512};
+  printf("%-7s %10s %12s %10s %12s %12s %11s %10s\n", "blocks", "motion_us", "collision_us", "tested", "linear_us", "linear_tested", "draw_us", "panel_ms");
+
+  for(uint8_t c = 0; c < sizeof(counts)/sizeof(counts[0]); c++){
+    randomSeed(1);
+    blockPoolReset();
+    for(uint16_t i = 0; i < counts[c]; i++){
+      blockAlloc(random(grassWidth, LCD_WIDTH - grassWidth - blockDim), random(0, LCD_HEIGHT), random(1, 4)*STEP_PER_TICK, colors[i % 10]);
+    }
+    x00 = LCD_WIDTH/2;
+    y00 = LCD_HEIGHT - offset;
+    textHudReset(&scoreHud, 1, 2);
+    textHudNumber(&scoreHud, 0);
+    uint64_t panelNs = 0, tested = 0, linearTested = 0;
+    double motion = 0, collision = 0, linear = 0, draw = 0;
+    uint32_t hits = 0, linearHits = 0;
+
+    for(int f = 0; f < BLOCKS_FRAMES; f++){
+      double t0 = hostSeconds();
+      for(uint16_t k = 0; k < blockCount; k++){
+        uint16_t i = blockActive[k];
+        if(!blockFall(i, LCD_HEIGHT)){ blockMove(i, random(grassWidth, LCD_WIDTH - grassWidth - blockDim), 0); }
+      }
+      double t1 = hostSeconds();
+      uint16_t x1 = x00 - tyreDim, y1 = y00, x2 = x00+tyreDim+carWidth, y2 = y00+carLength;
+      uint32_t tested0 = blockStats.tested;
+      hits += blockQuery(x1, y1, x2, y2, blockHits, BLOCK_POOL_SIZE);
+      tested += blockStats.tested - tested0;
+      double t2 = hostSeconds();
+      for(uint16_t k = 0; k < blockCount; k++){ //Linear scan, as the game did
+        uint16_t i = blockActive[k];
+        linearHits += (blockY[i]+blockDim >= y1) && (blockY[i] <= y2) && (blockX[i]+blockDim >= x1) && (blockX[i] <= x2);
+      }
+      linearTested += blockCount;
+      double t3 = hostSeconds();
+      uint64_t n0 = hostNowNs;
+      compositorBegin();
+      for(uint16_t k = 0; k < blockCount; k++){ damageBlock(blockActive[k]); }
+      addScene();
+      compositorFlush();
+      panelNs += hostNowNs - n0;
+      double t4 = hostSeconds();
+      motion += t1 - t0; collision += t2 - t1; linear += t3 - t2; draw += t4 - t3;
+    }
+    if(hits != linearHits){ printf("broadphase found %u hits, linear scan %u\n", hits, linearHits); }
+    printf("%-7u %10.2f %12.3f %10.1f %12.3f %12.1f %11.1f %10.2f\n", counts[c], motion*1e6/BLOCKS_FRAMES, collision*1e6/BLOCKS_FRAMES,
+           (double)tested/BLOCKS_FRAMES, linear*1e6/BLOCKS_FRAMES, (double)linearTested/BLOCKS_FRAMES,
+           draw*1e6/BLOCKS_FRAMES, panelNs/1e6/BLOCKS_FRAMES);
+  }
+}
+
+/** Game step report
+ *
+ * Every preset and drive mode run through its specialized game step and through the generic one, from the same seed
+ * and scripted samples, without drawing: both must play the same game. Host cycles are those of the step calls, host
+ * time that of the whole run, both per frame and best of STEPS_RUNS runs.
+ *
+ */
+#define STEPS_FRAMES 20000
+#define STEPS_RUNS 9
+
+uint32_t stepsRun(GameStep_t step, uint64_t *cycles, double *seconds){
+  uint32_t check = 0;
+  AdcFrame_t input = {{0, 0, 0, 0}, 0};
+  randomSeed(1);
+  collision = true;
+  *cycles = 0;
+  double t0 = hostSeconds();
+  for(uint32_t f = 0; f < STEPS_FRAMES; f++){
+    if(collision){ //New game, as fn_STATE_INIT_GAME would start it
+      check = check*31 + score;
+      blockPoolReset();
+      blockSpawns = 0;
+      score = tmp_score = 0;
+      timer = 0;
+      collision = false;
+      roadFall = 0;
+      vel = vel00;
+      speed = speedTarget = Q16(vel00);
+      stepVel = q16Mul(speed, STEP_PER_TICK);
+      x00 = grassWidth+tyreDim;
+      y00 = LCD_HEIGHT-offset;
+    }
+    double s = sin(f*0.05);
+    input.value[ADC_JOY_X] = input.value[ADC_JOY_Y] = 2048 + 2000*s;
+    input.value[ADC_ACC_X] = input.value[ADC_ACC_Y] = 2050 + 800*s;
+    uint64_t c0 = hostCycles();
+    step(1, &input);
+    *cycles += hostCycles() - c0;
+  }
+  *seconds = hostSeconds() - t0; //Whole run, resets included
+  return check*31 + score + blockSpawns;
+}
+
+int reportSteps(){
+  const char *difficulties[N_diff] = {"rookie", "champion", "legend"};
+  const char *modes[N_modes] = {"joystick", "accel"};
+  int mismatches = 0;
+  printf("%-9s %-9s %9s %9s %9s %9s %7s %s\n", "preset", "mode", "spec_cyc", "gen_cyc", "spec_ns", "gen_ns", "saved", "game");
+
+  for(uint8_t d = 0; d < N_diff; d++){
+    for(uint8_t m = 0; m < N_modes; m++){
+      for(uint8_t k = 0; k < MENU_EFFECTS; k++){
+        const MenuEffect_t *e = &difficultyOptions[d].effects[k];
+        if(e->setting != MENU_NONE){ applySetting(e->setting, e->value); }
+      }
+      driveMode = (m == 0);
+      gameSelect();
+      GameStep_t spec = gameStepFn, gen = gameSteps[N_diff][m];
+      uint64_t best[2] = {UINT64_MAX, UINT64_MAX};
+      double bestNs[2] = {1e9, 1e9};
+      uint32_t check[2] = {0, 0};
+      for(uint8_t r = 0; r < STEPS_RUNS; r++){ //Interleaved, so both see the same machine load
+        for(uint8_t v = 0; v < 2; v++){
+          uint64_t c;
+          double s;
+          check[v] = stepsRun(v ? gen : spec, &c, &s);
+          best[v] = min(best[v], c);
+          bestNs[v] = min(bestNs[v], s);
+        }
+      }
+      bool same = (check[0] == check[1]) && (spec == gameSteps[d][m]);
+      mismatches += !same;
+      printf("%-9s %-9s %9.1f %9.1f %9.1f %9.1f %6.1f%% %s\n", difficulties[d], modes[m], (double)best[0]/STEPS_FRAMES,
+             (double)best[1]/STEPS_FRAMES, bestNs[0]*1e9/STEPS_FRAMES, bestNs[1]*1e9/STEPS_FRAMES,
+             100.0*(1 - (double)best[0]/best[1]), same ? "identical" : "DIFFERENT");
+    }
+  }
+  return mismatches;
+}
+
+/** Latency report
+ *
+ * Play games until LATENCY_FRAMES frames are measured, for every drive mode, with the steering sampled at the start of
+ * the frame and late-latched, with the frames pushed by the CPU and queued for the DMA. The stick or the board is moved
+ * like in the default run. Latency is from the end of the conversions of the sample that placed the car to the end of
+ * the transfer of its frame (inputLatency.h).
+ *
+ */
+#define LATENCY_FRAMES 1000
+
+LatencyStats_t latencyTotal; //Games of the current run
+
+void latencyHook(){
+  if(current_state != STATE_GAME){ return; }
+  double t = hostNowNs/1e9;
+  hostAnalogValue[joystickX] = 2048 + (int)(1800*sin(t*1.3));
+  hostAnalogValue[joystickY] = 2048 + (int)(300*sin(t*7.1));
+  hostAnalogValue[xpin] = 2050 + (int)(700*sin(t*1.3));
+  hostAnalogValue[ypin] = 2050 + (int)(100*sin(t*7.1));
+  if(latencyTotal.frames + latencyStats.frames >= LATENCY_FRAMES){ hostDeadlineNs = hostNowNs; }
+}
+
+void latencyMerge(){ //Every game starts from zero (fn_STATE_INIT_GAME): add it to the run
+  latencyTotal.frames += latencyStats.frames;
+  latencyTotal.total_us += latencyStats.total_us;
+  latencyTotal.max_us = max(latencyTotal.max_us, latencyStats.max_us);
+  for(uint16_t b = 0; b < LATENCY_BINS; b++){ latencyTotal.bins[b] += latencyStats.bins[b]; }
+}
+
+void reportLatency(){
+  const char *modes[N_modes] = {"joystick", "accel"};
+  hostResetPins();
+  setup();
+  hostTickHook = latencyHook;
+  printf("%-8s %-9s %-6s %7s %8s %8s %8s %8s %8s\n", "display", "mode", "latch", "frames", "mean_ms", "p50_ms", "p90_ms", "p99_ms", "max_ms");
+
+  for(uint8_t async = 0; async < 2; async++){
+    for(uint8_t m = 0; m < N_modes; m++){
+      for(uint8_t late = 0; late < 2; late++){
+        memset(&latencyTotal, 0, sizeof(latencyTotal));
+        while(latencyTotal.frames < LATENCY_FRAMES){ //A collision starts a new game
+          driveMode = (m == 0);
+          lateLatch = late;
+          fn_STATE_INIT_GAME();
+          displayAsync(async);
+          try{ fn_STATE_GAME(); }
+          catch(HostStop &){ hostDeadlineNs = 0; current_state = STATE_CMD_GAME; roadEnd(); } //Out of the game: the hook stops too
+          latencyMerge();
+        }
+        latencyStats = latencyTotal; //For latencyPercentile
+        printf("%-8s %-9s %-6s %7u %8.2f %8.2f %8.2f %8.2f %8.2f\n", async ? "DMA" : "blocking", modes[m], late ? "late" : "start",
+               latencyStats.frames, latencyStats.total_us/1e3/latencyStats.frames, latencyPercentile(0.5)/1e3,
+               latencyPercentile(0.9)/1e3, latencyPercentile(0.99)/1e3, latencyStats.max_us/1e3);
+      }
+    }
+  }
+  hostTickHook = NULL;
+}
+
+/** Sweep check
+ *
+ * Blocks faster than a car and a block together (dy > carLength + BLOCK_SIZE) against a car in the middle of the
+ * road and at its bottom: a block whose step crosses the car must be found by blockSweep, or by blockSwept when the
+ * step leaves the screen, and one that stays clear must not. Returns the number of wrong answers.
+ *
+ */
+typedef struct{
+  const char *name;
+  uint8_t carY; //Car rows carY..carY+carLength
+  uint8_t blockY; //Before the step
+  uint8_t dy; //Rows of the step
+  bool hit;
+}SweepCase_t;
+
+int reportSweep(){
+  const SweepCase_t cases[] = {
+    {"over the car", 20, 0, 50, true},
+    {"ends on its top edge", 60, 0, 50, true},
+    {"stops above", 60, 0, 40, false},
+    {"already past", 20, 60, 50, false},
+    {"out at the bottom", LCD_HEIGHT - carLength, LCD_HEIGHT - carLength - 30, 60, true},
+    {"out, car higher up", 40, 100, 60, false}
+  };
+  static_assert(50 > carLength + BLOCK_SIZE, "the steps must be longer than a car and a block");
+  int wrong = 0;
+  printf("%-20s %5s %7s %4s %9s %s\n", "case", "car_y", "block_y", "dy", "expected", "found");
+  for(uint8_t c = 0; c < sizeof(cases)/sizeof(cases[0]); c++){
+    const SweepCase_t *t = &cases[c];
+    int16_t x1 = LCD_WIDTH/2 - tyreDim, x2 = LCD_WIDTH/2 + tyreDim + carWidth;
+    blockPoolReset();
+    uint16_t i = blockAlloc(LCD_WIDTH/2, t->blockY, Q16(t->dy), 0);
+    bool hit;
+    if(blockFall(i, LCD_HEIGHT)){ hit = blockSweep(x1, t->carY, x2, t->carY + carLength, t->dy, blockHits, 1) > 0; }
+    else{ hit = blockSwept(i, x1, t->carY, x2, t->carY + carLength); } //Left the screen: tested before the respawn, as the game does
+    wrong += (hit != t->hit);
+    printf("%-20s %5u %7u %4u %9s %s\n", t->name, t->carY, t->blockY, t->dy, t->hit ? "hit" : "clear", (hit == t->hit) ? "ok" : "WRONG");
+  }
+  return wrong;
+}
+
+/** Palette check
+ *
+ * rgb565() against calculateColour() for every 24-bit colour, then every palette entry against calculateColour() of
+ * the RGB it was written from. Returns the number of mismatches.
+ *
+ */
+int reportPalette(){
+  const uint8_t rgb[PAL_COLOURS][3] = {{0, 0, 0}, {255, 255, 255}, {255, 0, 0}, {0, 255, 0}, {0, 0, 255}, {128, 128, 128},
+    {255, 128, 0}, {0, 255, 255}, {255, 0, 255}, {138, 43, 226}, {245, 185, 185}, {255, 255, 0}, {0, 255, 127},
+    {255, 20, 147}, {0, 206, 209}, {0, 100, 0}, {255, 218, 155}}; //The calculateColour() calls the palette replaced
+  int errors = 0;
+  for(uint32_t c = 0; c < (1UL << 24); c++){
+    uint8_t r = c >> 16, g = c >> 8, b = c;
+    if(rgb565(r, g, b) != myScreen.calculateColour(r, g, b)){ errors++; }
+  }
+  printf("rgb565: %s on all 16777216 colours\n", errors ? "DIFFERENT" : "identical");
+  for(int k = 0; k < PAL_COLOURS; k++){
+    uint16_t expected = myScreen.calculateColour(rgb[k][0], rgb[k][1], rgb[k][2]);
+    bool same = (palette[k] == expected) && (paletteColour(k) == expected);
+    printf("palette %2d (%3u, %3u, %3u): 0x%04X %s\n", k, rgb[k][0], rgb[k][1], rgb[k][2], palette[k], same ? "identical" : "DIFFERENT");
+    if(!same){ errors++; }
+  }
+  return errors;
+}
+
+/** Score store report
+ *
+ * Submit new bests for random keys and run the idle writes after each one, as the game over page would, for the given
+ * number of sessions. Power is cut in the middle of a random flash operation every few sessions: after each cut the store
+ * is booted again and every key must hold at least the best that was fully saved before it. Returns the keys that lost a score.
+ *
+ */
+uint32_t reportStore(uint32_t sessions, uint32_t seed){
+  hostFlashReset();
+  randomSeed(seed);
+  scoreStoreBegin();
+  printf("empty store: boot scan %u us\n", storeStats.bootUs);
+
+  uint16_t saved[STORE_KEYS]; //Bests known to be in flash
+  memset(saved, 0, sizeof(saved));
+  uint32_t errors = 0, cuts = 0, maxBootUs = 0, maxBootRecords = 0;
+  uint64_t maxIdleNs = 0;
+  for(uint32_t n = 0; n < sessions; n++){
+    uint8_t key = random(STORE_KEYS);
+    scoreStoreSubmit(key, scoreStoreBest(key) + 1 + random(3));
+    if(random(16) == 0){ hostFlashFailAt = random(8); } //Power lost within the next few operations
+
+    while(1){
+      uint64_t t0 = hostNowNs;
+      bool wrote = scoreStoreIdle();
+      maxIdleNs = max(maxIdleNs, hostNowNs - t0);
+      if(hostFlashTorn){ break; }
+      if(!wrote){ memcpy(saved, scoreStore.best, sizeof(saved)); break; } //Everything in flash
+    }
+    if(!hostFlashTorn && (random(64) != 0)){ continue; } //Also reboot now and then without a cut
+
+    cuts += hostFlashTorn ? 1 : 0;
+    hostFlashTorn = false;
+    hostFlashFailAt = -1;
+    scoreStoreBegin();
+    if(storeStats.bootUs > maxBootUs){ maxBootUs = storeStats.bootUs; maxBootRecords = storeStats.records + storeStats.badRecords; }
+    for(uint8_t k = 0; k < STORE_KEYS; k++){
+      if(scoreStore.best[k] < saved[k]){ errors++; printf("key %u: %u after reboot, %u saved\n", k, scoreStore.best[k], saved[k]); }
+    }
+  }
+
+  printf("%u sessions, %u power cuts: %u records appended, %u compactions, %u programs not verified\n", sessions, cuts,
+         storeStats.appends, storeStats.compactions, storeStats.failures);
+  printf("flash: %u erases (", hostFlashStats.erases);
+  for(uint8_t s = 0; s < FLASH_STORE_SECTORS; s++){ printf("%s%u", s ? ", " : "", hostFlashStats.sectorErases[s]); }
+  printf(" per sector), %u programs, %u bytes\n", hostFlashStats.programs, hostFlashStats.bytesProgrammed);
+  printf("worst boot scan %u us (%u records), worst idle call %.2f ms\n", maxBootUs, maxBootRecords, maxIdleNs/1e6);
+  printf("scores lost at power cuts: %u --> %s\n", errors, errors ? "FAIL" : "ok");
+  return errors;
+}
+
+/** Replay report
+ *
+ * Play a recorded session through the FSM, starting from the game init state, in real time or at max speed,
+ * and check that it ends with the recorded score and collision frame.
+ *
+ */
+void reportReplay(const char *path, bool fast){
+  FILE *f = fopen(path, "rb");
+  if(f == NULL){ printf("cannot open %s\n", path); return; }
+  std::vector<uint8_t> stream;
+  for(int c = fgetc(f); c != EOF; c = fgetc(f)){ stream.push_back(c); }
+  fclose(f);
+
+  hostResetPins();
+  setup();
+  sessionReplay(stream.data(), stream.size(), fast);
+  current_state = STATE_INIT_GAME;
+  uint64_t t0 = hostNowNs;
+  double w0 = hostSeconds();
+  while(!session.replayed){ loop(); }
+  double wall = hostSeconds() - w0;
+
+  printf("replay of %s (%u bytes, %s): %u frames, score %u, collision frame %u\n", path, (unsigned)stream.size(),
+         fast ? "max speed" : "real time", session.frames, score, collision ? session.frames : 0);
+  printf("recorded: score %u, collision frame %u --> %s\n", session.score, session.collisionFrame, session.matched ? "identical" : "DIFFERENT");
+  printf("simulated time %.2f s, host time %.1f ms (%.0f frames/s)\n", (hostNowNs - t0)/1e9, wall*1e3, session.frames/wall);
+}
+
+int main(int argc, char **argv){
+  hostFlashReset();
+  if((argc > 1) && (strcmp(argv[1], "logo") == 0)){ reportLogo(); return 0; }
+  if((argc > 1) && (strcmp(argv[1], "bands") == 0)){ reportBands(); return 0; }
+  if((argc > 1) && (strcmp(argv[1], "scroll") == 0)){ reportScroll(); return 0; }
+  if((argc > 1) && (strcmp(argv[1], "music") == 0)){ reportMusic(); return 0; }
+  if((argc > 1) && (strcmp(argv[1], "blocks") == 0)){ reportBlocks(); return 0; }
+  if((argc > 1) && (strcmp(argv[1], "menu") == 0)){ reportMenu(); return 0; }
+  if((argc > 1) && (strcmp(argv[1], "tune") == 0)){
+    bool search = (argc > 2) && (strcmp(argv[2], "search") == 0);
+    int a = search ? 5 : 2; //First of [games] [workers]
+    tunerGames = (argc > a) ? atoi(argv[a]) : tunerGames;
+    tunerWorkers = (argc > a+1) ? atoi(argv[a+1]) : sysconf(_SC_NPROCESSORS_ONLN);
+    if(tunerGames < 1){ tunerGames = 1; }
+    if(search){ return tunerSearch((argc > 3) ? argv[3] : "", (argc > 4) ? atof(argv[4]) : 0); }
+    tunerPresets();
+    return 0;
+  }
+  if((argc > 1) && (strcmp(argv[1], "latency") == 0)){ reportLatency(); return 0; }
+  if((argc > 1) && (strcmp(argv[1], "steps") == 0)){ return (reportSteps() > 0) ? 1 : 0; }
+  if((argc > 1) && (strcmp(argv[1], "sweep") == 0)){ return (reportSweep() > 0) ? 1 : 0; }
+  if((argc > 1) && (strcmp(argv[1], "palette") == 0)){ return (reportPalette() > 0) ? 1 : 0; }
+  if((argc > 1) && (strcmp(argv[1], "store") == 0)){
+    return (reportStore((argc > 2) ? atoi(argv[2]) : 20000, (argc > 3) ? strtoul(argv[3], NULL, 10) : 1) > 0) ? 1 : 0;
+  }
+  if((argc > 1) && (strcmp(argv[1], "adc") == 0)){ reportAdc((argc > 2) ? argv[2] : NULL); return 0; }
+  if((argc > 1) && (strcmp(argv[1], "bench") == 0)){
+    return benchRun((argc > 2) && (strcmp(argv[2], "json") == 0), (argc > 3) ? argv[3] : NULL, (argc > 4) ? atof(argv[4]) : 5.0,
+                    (argc > 5) ? atof(argv[5]) : 25.0);
+  }
+  if((argc > 2) && (strcmp(argv[1], "replay") == 0)){ reportReplay(argv[2], (argc > 3) && (strcmp(argv[3], "fast") == 0)); return 0; }
+
+  if((argc > 1) && (strcmp(argv[1], "profile") == 0)){ hostSerialOut = stdout; argc--; argv++; } //Print the profiler dumps
+
+  const char *recordPath = NULL; //Session of the last game is saved here
+  if((argc > 2) && (strcmp(argv[1], "record") == 0)){ recordPath = argv[2]; argc -= 2; argv += 2; }
+
+  scriptGames = (argc > 1) ? atoi(argv[1]) : 1;
+  randomSeed((argc > 2) ? strtoul(argv[2], NULL, 10) : 1);
+
+  hostResetPins();
+  hostTickHook = scriptTick;
+  setup();
+
+  try{
+    while(1){
+      State_t state = current_state;
+      HostSnapshot_t from = hostSnapshot();
+      try{
+        loop();
+      }
+      catch(HostStop &){
+        chargeState(state, from);
+        throw;
+      }
+      chargeState(state, from);
+    }
+  }
+  catch(HostStop &){}
+
+  printReport();
+  if(recordPath != NULL){
+    FILE *f = fopen(recordPath, "wb");
+    if(f != NULL){ fwrite(sessionBuffer, 1, session.size, f); fclose(f); }
+    printf("session: %u bytes for %u frames%s, score %u, collision frame %u --> %s\n", session.size, session.frames,
+           session.truncated ? " (truncated)" : "", session.score, session.collisionFrame, (f != NULL) ? recordPath : "not saved");
+  }
+  return 0;
+}
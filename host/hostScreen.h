@@ -0,0 +1,244 @@
+/**
+ * @file hostScreen.h
+ *
+ * @brief In-memory mock of the HX8353E screen driver: keeps a framebuffer and counts draw calls, address windows, pixels and SPI bytes
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/**
+ * Colours defined by the LCD_screen library and not redefined by the game
+ */
+#define blackColour 0b0000000000000000
+#define whiteColour 0b1111111111111111
+#define redColour 0b1111100000000000
+#define greenColour 0b0000011111100000
+#define blueColour 0b0000000000011111
+
+/** Bus cost model
+ *
+ * Every address window is CASET + RASET + RAMWR: 3 command bytes and 8 parameter bytes.
+ * A scroll command is VSCRDEF (1 + 6 bytes) or VSCSAD (1 + 2 bytes).
+ * Every pixel is 2 bytes of RGB565. Each byte moved over SPI advances the simulated clock,
+ * and every burst of pixels pays the chip select and data/command toggling around it.
+ *
+ */
+#define HOST_SCREEN_SIZE 128
+#define HOST_WINDOW_BYTES 11
+#define HOST_PIXEL_BYTES 2
+#define HOST_SCROLL_AREA_BYTES 7
+#define HOST_SCROLL_START_BYTES 3
+#define HOST_SPI_NS_PER_BYTE 1000 //Byte time including the driver's per-byte DC/CS handling
+#define HOST_BURST_NS 2000 //Overhead of every SPI burst
+
+typedef struct{
+  uint32_t pointCalls; //point()
+  uint32_t rectangleCalls; //dRectangle() and rectangle()
+  uint32_t textCalls; //gText()
+  uint32_t clearCalls; //clear()
+  uint32_t windows; //Address windows set on the controller
+  uint32_t pixels; //Pixels pushed, including the ones falling outside the panel
+  uint32_t bytes; //Bytes clocked over SPI
+  uint32_t bursts; //Pixel bursts (SPI transactions)
+  uint32_t scrolls; //Scroll start commands
+}HostScreenStats_t;
+
+/** Mock screen
+ *
+ * Same public interface as Screen_HX8353E for the calls made by the game. Drawing goes through the same
+ * primitives as the real driver (one address window per point or solid rectangle, one point per font dot),
+ * so the counters reflect what the LaunchPad would push over SPI.
+ * frame[] is the controller memory; hostShown() reads what the panel displays through the vertical scroll.
+ * hostCommand() and hostData() take the raw bytes of the DMA path and decode them like the controller.
+ *
+ */
+class Screen_HX8353E{
+public:
+  HostScreenStats_t stats;
+  uint16_t frame[HOST_SCREEN_SIZE*HOST_SCREEN_SIZE];
+
+  Screen_HX8353E(){
+    memset(&stats, 0, sizeof(stats));
+    memset(frame, 0, sizeof(frame));
+    _penSolid = false;
+    _fontSolid = true;
+    _scrollTop = 0;
+    _scrollHeight = 0;
+    _scrollStart = 0;
+    _cx1 = _cy1 = 0;
+    _cx2 = _cy2 = HOST_SCREEN_SIZE-1;
+    _open(0, 0, HOST_SCREEN_SIZE-1, HOST_SCREEN_SIZE-1);
+  }
+
+  void begin(){
+    _penSolid = false;
+    _fontSolid = true;
+  }
+
+  uint16_t screenSizeX(){ return HOST_SCREEN_SIZE; }
+  uint16_t screenSizeY(){ return HOST_SCREEN_SIZE; }
+
+  uint16_t calculateColour(uint8_t red, uint8_t green, uint8_t blue){
+    return (red >> 3) << 11 | (green >> 2) << 5 | (blue >> 3);
+  }
+
+  void setPenSolid(bool flag = true){ _penSolid = flag; }
+  void setFontSolid(bool flag = true){ _fontSolid = flag; }
+
+  void clear(uint16_t colour = blackColour){
+    stats.clearCalls++;
+    _fill(0, 0, HOST_SCREEN_SIZE-1, HOST_SCREEN_SIZE-1, colour);
+  }
+
+  void point(uint16_t x1, uint16_t y1, uint16_t colour){
+    stats.pointCalls++;
+    _fill(x1, y1, x1, y1, colour);
+  }
+
+  void rectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t colour){
+    stats.rectangleCalls++;
+    if(_penSolid){
+      _fill(x1, y1, x2, y2, colour);
+    }
+    else{
+      _fill(x1, y1, x2, y1, colour);
+      _fill(x1, y2, x2, y2, colour);
+      _fill(x1, y1, x1, y2, colour);
+      _fill(x2, y1, x2, y2, colour);
+    }
+  }
+
+  void dRectangle(uint16_t x0, uint16_t y0, uint16_t dx, uint16_t dy, uint16_t colour){
+    if((dx == 0) || (dy == 0)){ return; }
+    rectangle(x0, y0, x0+dx-1, y0+dy-1, colour);
+  }
+
+  void gText(uint16_t x0, uint16_t y0, String s, uint16_t textColour = whiteColour, uint16_t backColour = blackColour, uint8_t ix = 1, uint8_t iy = 1){
+    stats.textCalls++;
+    for(uint8_t k = 0; k < s.length(); k++){
+      hostGlyph(x0+k*6*ix, y0, s.charAt(k), textColour, backColour, ix, iy, _fontSolid);
+    }
+  }
+
+  /**
+   * Draw one 6x8 font cell the way LCD_screen_font does: one point (or ix*iy rectangle) per dot
+   */
+  void hostGlyph(uint16_t x0, uint16_t y0, char c, uint16_t textColour, uint16_t backColour, uint8_t ix, uint8_t iy, bool solid){
+    if((c < 0x20) || (c > 0x7E)){ c = ' '; }
+    for(uint8_t i = 0; i < 6; i++){
+      uint8_t line = (i < 5) ? font5x7[c-0x20][i] : 0x00;
+      for(uint8_t j = 0; j < 8; j++){
+        bool dot = (line >> j) & 0x01;
+        if(!dot && !solid){ continue; }
+        _fill(x0+i*ix, y0+j*iy, x0+i*ix+ix-1, y0+j*iy+iy-1, dot ? textColour : backColour);
+      }
+    }
+  }
+
+  /**
+   * Bus level access: open an address window, then stream pixels into it in raster order
+   */
+  void hostWindow(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2){
+    _open(x1, y1, x2, y2);
+    stats.windows++;
+    _spend(HOST_WINDOW_BYTES);
+  }
+
+  void hostPixels(const uint16_t *colours, uint32_t n){
+    for(uint32_t i = 0; i < n; i++){ _store(colours[i]); }
+    _burst(n);
+  }
+
+  void hostRepeat(uint16_t colour, uint32_t n){
+    for(uint32_t i = 0; i < n; i++){ _store(colour); }
+    _burst(n);
+  }
+
+  uint16_t hostGet(uint16_t x, uint16_t y){
+    return ((x < HOST_SCREEN_SIZE) && (y < HOST_SCREEN_SIZE)) ? frame[y*HOST_SCREEN_SIZE+x] : 0;
+  }
+
+  /**
+   * Byte level access: a command with its parameters, clocked by the CPU, then data bytes (pixels after RAMWR),
+   * counted but not timed: the DMA model of hal.h charges the transfer
+   */
+  void hostCommand(uint8_t command, const uint8_t *params, uint8_t n){
+    _spend(1 + n);
+    switch(command){
+      case LCD_CASET: if(n >= 4){ _cx1 = (params[0] << 8) | params[1]; _cx2 = (params[2] << 8) | params[3]; } break;
+      case LCD_RASET: if(n >= 4){ _cy1 = (params[0] << 8) | params[1]; _cy2 = (params[2] << 8) | params[3]; } break;
+      case LCD_RAMWR: _open(_cx1, _cy1, _cx2, _cy2); stats.windows++; break;
+      case LCD_VSCRDEF: if(n >= 4){ _scrollTop = (params[0] << 8) | params[1]; _scrollHeight = (params[2] << 8) | params[3]; } break;
+      case LCD_VSCSAD: if(n >= 2){ _scrollStart = (params[0] << 8) | params[1]; stats.scrolls++; } break;
+    }
+  }
+
+  void hostData(const uint8_t *data, uint32_t n){
+    for(uint32_t i = 0; i+1 < n; i += 2){ _store((data[i] << 8) | data[i+1]); }
+    stats.pixels += n/HOST_PIXEL_BYTES;
+    stats.bursts++;
+    stats.bytes += n;
+  }
+
+  /**
+   * Vertical scroll: VSCRDEF and VSCSAD, and the pixel the panel shows at (x, y)
+   */
+  void hostScrollArea(uint16_t top, uint16_t height){
+    _scrollTop = min(top, (uint16_t)HOST_SCREEN_SIZE);
+    _scrollHeight = min(height, (uint16_t)(HOST_SCREEN_SIZE - _scrollTop));
+    _spend(HOST_SCROLL_AREA_BYTES);
+  }
+
+  void hostScrollStart(uint16_t row){
+    _scrollStart = row;
+    stats.scrolls++;
+    _spend(HOST_SCROLL_START_BYTES);
+  }
+
+  uint16_t hostShown(uint16_t x, uint16_t y){
+    if((y >= _scrollTop) && (y < _scrollTop + _scrollHeight) && (_scrollStart >= _scrollTop) && (_scrollStart < _scrollTop + _scrollHeight)){
+      y = _scrollTop + (_scrollStart - _scrollTop + y - _scrollTop) % _scrollHeight;
+    }
+    return hostGet(x, y);
+  }
+
+private:
+  bool _penSolid;
+  bool _fontSolid;
+  uint16_t _wx1, _wy1, _wx2, _wy2, _wx, _wy;
+  uint16_t _scrollTop, _scrollHeight, _scrollStart;
+  uint16_t _cx1, _cx2, _cy1, _cy2; //CASET and RASET parameters received
+
+  void _spend(uint32_t bytes){
+    stats.bytes += bytes;
+    hostAdvance((uint64_t)bytes*HOST_SPI_NS_PER_BYTE);
+  }
+
+  void _burst(uint32_t n){
+    stats.pixels += n;
+    stats.bursts++;
+    hostAdvance(HOST_BURST_NS);
+    _spend(n*HOST_PIXEL_BYTES);
+  }
+
+  void _open(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2){
+    if(x1 > x2){ uint16_t t = x1; x1 = x2; x2 = t; }
+    if(y1 > y2){ uint16_t t = y1; y1 = y2; y2 = t; }
+    _wx1 = x1; _wy1 = y1; _wx2 = x2; _wy2 = y2;
+    _wx = x1; _wy = y1;
+  }
+
+  void _store(uint16_t colour){ //Write at the window cursor and advance it like the controller does
+    if((_wx < HOST_SCREEN_SIZE) && (_wy < HOST_SCREEN_SIZE)){ frame[_wy*HOST_SCREEN_SIZE+_wx] = colour; }
+    if(_wx < _wx2){ _wx++; }
+    else{
+      _wx = _wx1;
+      _wy = (_wy < _wy2) ? _wy+1 : _wy1;
+    }
+  }
+
+  void _fill(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t colour){
+    hostWindow(x1, y1, x2, y2);
+    hostRepeat(colour, (uint32_t)(_wx2-_wx1+1)*(_wy2-_wy1+1));
+  }
+};
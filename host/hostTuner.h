@@ -0,0 +1,427 @@
+/**
+ * @file hostTuner.h
+ *
+ * @brief Monte Carlo difficulty tuner: seeded headless games driven by an autopilot, forked on every core, and a search for target survival curves
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/** Tuner
+ *
+ * 1. Every game is a job (parameter set, seed) and runs the unchanged INIT_GAME and GAME states with an autopilot
+ *    on the joystick, until the first collision or TUNER_MAX_S of game time
+ * 2. The simulation is not re-entrant: the game state is the sketch's globals, so one process plays one game at a
+ *    time and the tuner is a process fan-out. The runner is set up once, then every game runs in a fork of it. Each
+ *    game starts from the same snapshot whatever worker runs it, so the results only depend on the jobs, not on the
+ *    number of workers or on the order they run in
+ * 3. Workers are processes, not threads, sharing the job ranges and the results through shared memory: each one takes
+ *    jobs from the front of its own range and, when it runs out, steals the back half of the largest range left
+ * 4. Every parameter set plays the same seeds, so two sets are compared on the same block sequences
+ * 5. A game whose process does not exit with status 0 (crash, abort) is reported and left out of the statistics of its set
+ * 6. Per set: score and survival percentiles, survival curve (games still alive every TUNER_CHECKPOINT_S seconds),
+ *    frame work percentiles and overruns
+ * 7. Search: coordinate descent over the difficulty parameters, from a preset, towards a survival curve halving
+ *    every <median> seconds (loss = mean squared distance between the curves at the checkpoints)
+ *
+ */
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#define TUNER_MAX_S 180 //Games still alive after this time are stopped and counted as survivors
+#define TUNER_CHECKPOINT_S 10
+#define TUNER_CHECKPOINTS (TUNER_MAX_S/TUNER_CHECKPOINT_S)
+#define TUNER_COST_BUCKETS 64 //Frame work histogram, last bucket holds everything above
+#define TUNER_COST_BUCKET_US 100
+#define TUNER_MAX_WORKERS 64
+#define TUNER_SEARCH_ITERS 12
+#define TUNER_PARAMS 6
+
+//Autopilot: a player that sees the road late and cannot move the stick instantly
+#define AUTOPILOT_REACTION_MS 150 //Time between two looks at the road
+#define AUTOPILOT_STEER_PX_S 150 //Max speed of the steering target
+#define AUTOPILOT_LOOKAHEAD 80 //Rows above the car that are watched
+#define AUTOPILOT_MARGIN 2 //Columns kept free on both sides of the car (collision edges are inclusive)
+
+typedef struct{
+  int16_t value[TUNER_PARAMS]; //vel00, waitTime, upperRandom, collectPoints, blocksNumber, speedGain
+}TunerParams_t;
+
+typedef struct{
+  bool ok; //Played to the end and exited cleanly
+  uint16_t score;
+  bool survived; //Still alive at TUNER_MAX_S
+  uint32_t survivalMs;
+  uint32_t frames;
+  uint32_t overruns;
+  uint64_t workUs;
+  uint32_t cost[TUNER_COST_BUCKETS]; //Frames per work time bucket
+}TunerGame_t;
+
+typedef struct{
+  std::atomic<uint64_t> range[TUNER_MAX_WORKERS]; //Jobs left to each worker: first << 32 | end
+  std::atomic<uint32_t> steals;
+  std::atomic<uint32_t> done;
+  std::atomic<uint32_t> failed;
+}TunerPool_t;
+
+typedef struct{
+  uint32_t games; //Games that ended cleanly
+  double scoreP10, scoreP50, scoreP90, scoreMean;
+  double survivalP10, survivalP50, survivalP90; //Seconds
+  double alive[TUNER_CHECKPOINTS+1]; //Fraction of games alive at every checkpoint, alive[0] = 1
+  double workMean, workP50, workP99; //Microseconds per frame
+  double overrunsPer1k;
+  double loss;
+}TunerStats_t;
+
+const char *tunerParamNames[TUNER_PARAMS] = {"vel00", "waitTime", "upperRandom", "collectPoints", "blocksNumber", "speedGain"};
+const int16_t tunerParamMin[TUNER_PARAMS] = {1, 15, 10, 3, 3, 64};
+const int16_t tunerParamMax[TUNER_PARAMS] = {4, 60, 80, 10, 10, 512};
+const int16_t tunerParamStep[TUNER_PARAMS] = {1, 5, 10, 1, 1, 64};
+const uint8_t tunerParamSetting[TUNER_PARAMS] = {SET_VEL, SET_WAIT_TIME, SET_UPPER_RANDOM, SET_COLLECT_POINTS, SET_BLOCKS_NUMBER, SET_SPEED_GAIN};
+
+uint32_t tunerGames = 200; //Seeds per parameter set
+uint32_t tunerWorkers = 1;
+
+/** Autopilot functions
+ *
+ * 1. autopilotLook --> pick the car position whose nearest falling block is farthest, preferring short moves
+ * 2. tunerHook --> tick hook: look at the road every AUTOPILOT_REACTION_MS, move the stick towards the target,
+ *    nudge the stick vertically every frame (the car only moves when both coordinates change) and sample frame work
+ *
+ */
+TunerGame_t *tunerOut = NULL;
+int16_t autopilotTarget = 0;
+double autopilotX = 0;
+uint64_t autopilotLookNs = 0, autopilotLastNs = 0;
+uint32_t tunerFrames = 0;
+
+int16_t autopilotLook(){
+  const int16_t minX = grassWidth+tyreDim, maxX = LCD_WIDTH-(grassWidth+carWidth+tyreDim);
+  int16_t best = x00;
+  int32_t bestScore = INT32_MIN;
+  for(int16_t cx = minX; cx <= maxX; cx++){
+    int16_t clear = AUTOPILOT_LOOKAHEAD; //Rows before a block reaches the car, in this position
+    for(uint16_t k = 0; k < blockCount; k++){
+      uint16_t i = blockActive[k];
+      if((blockX[i]+blockDim+AUTOPILOT_MARGIN <= cx-tyreDim) || (blockX[i] >= cx+carWidth+tyreDim+AUTOPILOT_MARGIN)){ continue; }
+      if(blockY[i] >= y00+carLength){ continue; } //Already behind the car
+      clear = min(clear, (int16_t)max(0, y00 - (blockY[i]+blockDim)));
+    }
+    int32_t s = (int32_t)clear*8 - abs(cx - (int16_t)autopilotX);
+    if(s > bestScore){ bestScore = s; best = cx; }
+  }
+  return best;
+}
+
+void tunerHook(){
+  if(current_state != STATE_GAME){ return; }
+  if(hostNowNs >= autopilotLookNs){
+    autopilotTarget = autopilotLook();
+    autopilotLookNs = hostNowNs + AUTOPILOT_REACTION_MS*1000000ULL;
+  }
+  double step = (hostNowNs - autopilotLastNs)/1e9*AUTOPILOT_STEER_PX_S;
+  autopilotLastNs = hostNowNs;
+  if(autopilotX < autopilotTarget){ autopilotX = min(autopilotX + step, (double)autopilotTarget); }
+  else{ autopilotX = max(autopilotX - step, (double)autopilotTarget); }
+  hostAnalogValue[joystickX] = (uint16_t)(autopilotX*32 + 16); //Inverse of the game's map(0..4096 -> 0..128)
+  hostAnalogValue[joystickY] = (gameFrames.frames % 2) ? 2048 : 2112;
+
+  if(gameFrames.frames != tunerFrames){ //frameSchedulerWait() ended a frame
+    tunerFrames = gameFrames.frames;
+    tunerOut->workUs += gameFrames.work_us;
+    tunerOut->cost[min(gameFrames.work_us/TUNER_COST_BUCKET_US, (uint32_t)TUNER_COST_BUCKETS-1)]++;
+  }
+}
+
+/** Game function
+ *
+ * Play one game with parameters p from seed, in the calling process (which it leaves in game over state)
+ *
+ */
+void tunerGame(const TunerParams_t *p, uint32_t seed, TunerGame_t *out){
+  for(uint8_t k = 0; k < TUNER_PARAMS; k++){ applySetting(tunerParamSetting[k], p->value[k]); }
+  driveMode = true;
+  session.mode = SESSION_OFF;
+  randomSeed(seed); //With the same start time in every fork, the game seed only depends on this one
+
+  memset(out, 0, sizeof(*out));
+  tunerOut = out;
+  tunerFrames = 0;
+  autopilotX = autopilotTarget = grassWidth+tyreDim;
+  autopilotLookNs = autopilotLastNs = hostNowNs;
+  hostTickHook = tunerHook;
+
+  fn_STATE_INIT_GAME();
+  uint64_t start = hostNowNs;
+  hostDeadlineNs = start + TUNER_MAX_S*1000000000ULL;
+  try{ fn_STATE_GAME(); }
+  catch(HostStop &){ out->survived = true; }
+  hostDeadlineNs = 0;
+
+  out->survivalMs = (hostNowNs - start)/1000000;
+  out->score = score;
+  out->frames = tunerFrames;
+  out->overruns = gameFrames.overruns;
+  out->ok = true;
+}
+
+/** Pool functions
+ *
+ * 1. tunerNext --> next job of worker w: the front of its range, or the back half of the largest range left;
+ *    returns false when no range has jobs for it
+ * 2. tunerStatus --> true if a child exited with status 0, else print why it did not
+ * 3. tunerRun --> run jobs 0..n-1 on tunerWorkers processes, one fork per game, results[j] written by job j; the games
+ *    that failed, or that a failed worker never played, keep ok false
+ *
+ */
+bool tunerNext(TunerPool_t *pool, uint32_t w, uint32_t *job){
+  while(1){
+    uint64_t r = pool->range[w].load();
+    uint32_t first = r >> 32, end = (uint32_t)r;
+    if(first < end){
+      if(pool->range[w].compare_exchange_weak(r, ((uint64_t)(first+1) << 32) | end)){ *job = first; return true; }
+      continue;
+    }
+
+    uint32_t victim = w, most = 1; //A single job left is for its owner
+    for(uint32_t v = 0; v < tunerWorkers; v++){
+      uint64_t rv = pool->range[v].load();
+      uint32_t left = (uint32_t)rv - (uint32_t)(rv >> 32);
+      if(((uint32_t)rv > (uint32_t)(rv >> 32)) && (left > most)){ most = left; victim = v; }
+    }
+    if(victim == w){ return false; }
+    uint64_t rv = pool->range[victim].load();
+    uint32_t vFirst = rv >> 32, vEnd = (uint32_t)rv;
+    if(vEnd <= vFirst+1){ continue; } //Taken meanwhile, look again
+    uint32_t mid = vFirst + (vEnd - vFirst)/2;
+    if(!pool->range[victim].compare_exchange_strong(rv, ((uint64_t)vFirst << 32) | mid)){ continue; }
+    pool->range[w].store(((uint64_t)(mid+1) << 32) | vEnd); //Own range is empty, nobody else writes it
+    pool->steals++;
+    *job = mid;
+    return true;
+  }
+}
+
+bool tunerStatus(const char *what, uint32_t id, int status){
+  if(WIFEXITED(status) && (WEXITSTATUS(status) == 0)){ return true; }
+  if(WIFSIGNALED(status)){ fprintf(stderr, "tuner: %s %u killed by signal %d\n", what, id, WTERMSIG(status)); }
+  else{ fprintf(stderr, "tuner: %s %u exited with status %d\n", what, id, WEXITSTATUS(status)); }
+  return false;
+}
+
+void tunerRun(const std::vector<TunerParams_t> &sets, std::vector<TunerGame_t> &results){
+  uint32_t n = sets.size()*tunerGames;
+  size_t bytes = sizeof(TunerPool_t) + n*sizeof(TunerGame_t);
+  void *shared = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if(shared == MAP_FAILED){ perror("mmap"); exit(1); }
+  TunerPool_t *pool = new(shared) TunerPool_t;
+  TunerGame_t *games = (TunerGame_t *)((uint8_t *)shared + sizeof(TunerPool_t));
+  for(uint32_t w = 0; w < TUNER_MAX_WORKERS; w++){
+    uint64_t first = (uint64_t)n*w/tunerWorkers, end = (uint64_t)n*(w+1)/tunerWorkers;
+    pool->range[w].store((w < tunerWorkers) ? ((first << 32) | end) : 0);
+  }
+  pool->steals.store(0);
+  pool->done.store(0);
+  pool->failed.store(0);
+
+  fflush(stdout);
+  fflush(stderr);
+  pid_t workers[TUNER_MAX_WORKERS];
+  for(uint32_t w = 0; w < tunerWorkers; w++){
+    if((workers[w] = fork()) != 0){ continue; }
+    uint32_t job;
+    while(tunerNext(pool, w, &job)){
+      pid_t pid = fork();
+      if(pid == 0){
+        tunerGame(&sets[job/tunerGames], 1 + job%tunerGames, &games[job]);
+        _exit(0);
+      }
+      int status;
+      if((pid < 0) || (waitpid(pid, &status, 0) != pid) || !tunerStatus("game", job, status)){
+        games[job].ok = false; //Whatever it wrote before failing
+        pool->failed++;
+      }
+      pool->done++;
+    }
+    _exit(0);
+  }
+  for(uint32_t w = 0; w < tunerWorkers; w++){
+    int status;
+    if((workers[w] > 0) && (waitpid(workers[w], &status, 0) == workers[w])){ tunerStatus("worker", w, status); }
+  }
+
+  results.assign(games, games+n);
+  uint32_t missing = n - pool->done.load(); //Left by a failed worker
+  fprintf(stderr, "tuner: %u games on %u workers, %u steals", pool->done.load(), tunerWorkers, pool->steals.load());
+  if(pool->failed.load() + missing > 0){ fprintf(stderr, ", %u failed, %u not played", pool->failed.load(), missing); }
+  fprintf(stderr, "\n");
+  munmap(shared, bytes);
+}
+
+/** Statistics functions
+ *
+ * 1. tunerPercentile --> p-th percentile of a sorted vector
+ * 2. tunerStats --> statistics of the games of a set that ended cleanly, loss against a curve halving every median seconds
+ *    (0 = none); a set with no such game gets an infinite loss
+ * 3. tunerPrint --> CSV row of a set, and its survival curve when curve is true
+ *
+ */
+double tunerPercentile(const std::vector<double> &sorted, double p){
+  if(sorted.empty()){ return 0; }
+  return sorted[(size_t)(p*(sorted.size()-1) + 0.5)];
+}
+
+TunerStats_t tunerStats(const TunerGame_t *games, double median){
+  TunerStats_t st;
+  std::vector<double> scores, survival;
+  uint32_t cost[TUNER_COST_BUCKETS] = {0};
+  uint64_t frames = 0, workUs = 0, overruns = 0;
+  st.games = 0;
+  for(uint32_t g = 0; g < tunerGames; g++){
+    if(!games[g].ok){ continue; }
+    st.games++;
+    scores.push_back(games[g].score);
+    survival.push_back(games[g].survivalMs/1e3);
+    for(uint8_t b = 0; b < TUNER_COST_BUCKETS; b++){ cost[b] += games[g].cost[b]; }
+    frames += games[g].frames;
+    workUs += games[g].workUs;
+    overruns += games[g].overruns;
+  }
+  std::sort(scores.begin(), scores.end());
+  std::sort(survival.begin(), survival.end());
+  double sum = 0;
+  for(size_t k = 0; k < scores.size(); k++){ sum += scores[k]; }
+  st.scoreP10 = tunerPercentile(scores, 0.1);
+  st.scoreP50 = tunerPercentile(scores, 0.5);
+  st.scoreP90 = tunerPercentile(scores, 0.9);
+  st.scoreMean = st.games ? sum/st.games : 0;
+  st.survivalP10 = tunerPercentile(survival, 0.1);
+  st.survivalP50 = tunerPercentile(survival, 0.5);
+  st.survivalP90 = tunerPercentile(survival, 0.9);
+
+  st.loss = 0;
+  for(uint8_t c = 0; c <= TUNER_CHECKPOINTS; c++){
+    double t = c*TUNER_CHECKPOINT_S;
+    uint32_t alive = 0;
+    for(uint32_t g = 0; g < tunerGames; g++){ if(games[g].ok && (games[g].survived || (games[g].survivalMs > t*1e3))){ alive++; } }
+    st.alive[c] = st.games ? (double)alive/st.games : 0;
+    if(median > 0){ double d = st.alive[c] - pow(0.5, t/median); st.loss += d*d/(TUNER_CHECKPOINTS+1); }
+  }
+
+  st.workMean = frames ? (double)workUs/frames : 0;
+  st.workP50 = st.workP99 = 0;
+  uint64_t seen = 0;
+  for(uint8_t b = 0; b < TUNER_COST_BUCKETS; b++){ //Upper edge of the bucket holding the percentile
+    if((seen < 0.50*frames) && (seen + cost[b] >= 0.50*frames)){ st.workP50 = (b+1)*TUNER_COST_BUCKET_US; }
+    if((seen < 0.99*frames) && (seen + cost[b] >= 0.99*frames)){ st.workP99 = (b+1)*TUNER_COST_BUCKET_US; }
+    seen += cost[b];
+  }
+  st.overrunsPer1k = frames ? 1000.0*overruns/frames : 0;
+  if(st.games == 0){ st.loss = INFINITY; }
+  return st;
+}
+
+void tunerHeader(){
+  printf("set");
+  for(uint8_t k = 0; k < TUNER_PARAMS; k++){ printf(",%s", tunerParamNames[k]); }
+  printf(",games,score_p10,score_p50,score_p90,score_mean,survival_p10_s,survival_p50_s,survival_p90_s,alive_at_max,"
+         "work_mean_us,work_p50_us,work_p99_us,overruns_per_1k,loss\n");
+}
+
+void tunerPrint(const char *name, const TunerParams_t *p, const TunerStats_t *st, bool curve){
+  printf("%s", name);
+  for(uint8_t k = 0; k < TUNER_PARAMS; k++){ printf(",%d", p->value[k]); }
+  printf(",%u,%.0f,%.0f,%.0f,%.2f,%.1f,%.1f,%.1f,%.3f,%.1f,%.0f,%.0f,%.2f,%.5f\n", st->games, st->scoreP10, st->scoreP50,
+         st->scoreP90, st->scoreMean, st->survivalP10, st->survivalP50, st->survivalP90, st->alive[TUNER_CHECKPOINTS],
+         st->workMean, st->workP50, st->workP99, st->overrunsPer1k, st->loss);
+  if(!curve){ return; }
+  printf("curve,%s", name);
+  for(uint8_t c = 0; c <= TUNER_CHECKPOINTS; c++){ printf(",%.3f", st->alive[c]); }
+  printf("\n");
+}
+
+/** Tuner entry functions
+ *
+ * 1. tunerPreset --> parameters written by a difficulty option of the menu
+ * 2. tunerPresets --> play every difficulty and print its statistics and survival curve
+ * 3. tunerSearch --> from the preset of difficulty d, move one parameter at a time by one step while the loss against
+ *    the target curve decreases; every iteration plays all the neighbours of the current set in one parallel batch
+ *
+ */
+TunerParams_t tunerPreset(uint8_t d){
+  TunerParams_t p;
+  for(uint8_t k = 0; k < TUNER_PARAMS; k++){
+    p.value[k] = 0;
+    for(uint8_t e = 0; e < MENU_EFFECTS; e++){
+      if(difficultyOptions[d].effects[e].setting == tunerParamSetting[k]){ p.value[k] = difficultyOptions[d].effects[e].value; }
+    }
+  }
+  return p;
+}
+
+void tunerSetup(){
+  hostResetPins();
+  setup(); //Snapshot every game is forked from
+  if(tunerWorkers < 1){ tunerWorkers = 1; }
+  if(tunerWorkers > TUNER_MAX_WORKERS){ tunerWorkers = TUNER_MAX_WORKERS; }
+}
+
+const char *tunerDifficulties[N_diff] = {"rookie", "champion", "legend"};
+
+void tunerPresets(){
+  tunerSetup();
+  std::vector<TunerParams_t> sets;
+  for(uint8_t d = 0; d < N_diff; d++){ sets.push_back(tunerPreset(d)); }
+  std::vector<TunerGame_t> results;
+  tunerRun(sets, results);
+
+  tunerHeader();
+  for(uint8_t d = 0; d < N_diff; d++){
+    TunerStats_t st = tunerStats(&results[d*tunerGames], 0);
+    tunerPrint(tunerDifficulties[d], &sets[d], &st, true);
+  }
+}
+
+int tunerSearch(const char *difficulty, double median){
+  uint8_t d = 0;
+  while((d < N_diff) && (strcmp(tunerDifficulties[d], difficulty) != 0)){ d++; }
+  if((d == N_diff) || (median <= 0)){ fprintf(stderr, "tune search: rookie|champion|legend and a median survival in seconds\n"); return 1; }
+  tunerSetup();
+
+  TunerParams_t current = tunerPreset(d);
+  std::vector<TunerParams_t> sets(1, current);
+  std::vector<TunerGame_t> results;
+  tunerRun(sets, results);
+  TunerStats_t best = tunerStats(&results[0], median);
+  tunerHeader();
+  tunerPrint("start", &current, &best, true);
+
+  for(uint8_t iter = 0; iter < TUNER_SEARCH_ITERS; iter++){
+    sets.clear();
+    for(uint8_t k = 0; k < TUNER_PARAMS; k++){
+      for(int8_t dir = -1; dir <= 1; dir += 2){
+        TunerParams_t n = current;
+        n.value[k] += dir*tunerParamStep[k];
+        if((n.value[k] >= tunerParamMin[k]) && (n.value[k] <= tunerParamMax[k])){ sets.push_back(n); }
+      }
+    }
+    tunerRun(sets, results);
+
+    int32_t pick = -1;
+    for(size_t s = 0; s < sets.size(); s++){
+      TunerStats_t st = tunerStats(&results[s*tunerGames], median);
+      if(st.loss < best.loss){ best = st; pick = s; }
+    }
+    if(pick < 0){ break; } //No neighbour is closer to the target
+    current = sets[pick];
+    char name[16];
+    snprintf(name, sizeof(name), "iter%u", iter+1);
+    tunerPrint(name, &current, &best, true);
+  }
+
+  printf("\n//%s, median survival %.0f s with the autopilot\n{%d, %d, %d, %d, %d, %d}, //%s\n", difficulty, median,
+         current.value[0], current.value[1], current.value[2], current.value[3], current.value[4], current.value[5], difficultyOptions[d].label+2);
+  return 0;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file imageBlit.h
+ *
+ * @brief Bulk image blit: sets the address window once and streams RGB565 rows from flash
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/**
+ * Image descriptor: pixels stay in flash, only the descriptor is needed to blit them
+ */
+typedef struct{
+  uint8_t width;
+  uint8_t height;
+  bool columnMajor; //true if pixels are stored column after column (png2c layout), false if row after row
+  const uint16_t *pixels;
+}Image_t;
+
+/**
+ * Blit job: keeps track of the next row so that an image can be drawn a few rows at a time
+ */
+typedef struct{
+  const Image_t *image;
+  uint8_t x0, y0; //Top-left corner on screen
+  uint8_t row; //Next row to be pushed
+}BlitJob_t;
+
+uint16_t blitLine[LCD_WIDTH]; //Row gathered from a column-major image
+
+/** Blit begin function
+ *
+ * Prepare a job that draws image with its top-left corner in (x0, y0)
+ *
+ */
+void blitBegin(BlitJob_t *job, const Image_t *image, uint8_t x0, uint8_t y0){
+  job->image = image;
+  job->x0 = x0;
+  job->y0 = y0;
+  job->row = 0;
+}
+
+/** Blit step function
+ *
+ * Push up to rows rows (0 = all the remaining ones) inside a single address window.
+ * Returns true when the whole image has been drawn. Other drawing can safely happen between two steps,
+ * since every step opens its own window.
+ *
+ */
+bool blitStep(BlitJob_t *job, uint8_t rows){
+  const Image_t *img = job->image;
+  uint8_t w = min(img->width, LCD_WIDTH - job->x0); //Clip to the screen
+  uint8_t h = min(img->height, LCD_HEIGHT - job->y0);
+  if(job->row >= h){ return true; }
+
+  uint8_t last = ((rows == 0) || (job->row + rows > h)) ? h : job->row + rows;
+  lcdWindow(job->x0, job->y0+job->row, job->x0+w-1, job->y0+last-1);
+
+  for(; job->row < last; job->row++){
+    if(img->columnMajor){
+      for(uint8_t i = 0; i < w; i++){ blitLine[i] = img->pixels[(uint32_t)i*img->height + job->row]; }
+      lcdPushPixels(blitLine, w);
+    }
+    else{
+      lcdPushPixels(&img->pixels[(uint32_t)job->row*img->width], w); //Straight from flash
+    }
+  }
+  return job->row >= h;
+}
+
+/** Blit image function
+ *
+ * Draw the whole image at (x0, y0) with a single address window
+ *
+ */
+void blitImage(const Image_t *image, uint8_t x0, uint8_t y0){
+  BlitJob_t job;
+  blitBegin(&job, image, x0, y0);
+  blitStep(&job, 0);
+}
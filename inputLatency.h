@@ -0,0 +1,105 @@
+/**
+ * @file inputLatency.h
+ *
+ * @brief Input-to-display latency of the game frames: age of the steering sample when the car it placed reaches the panel
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/** Input Latency
+ *
+ * 1. latencyFrame --> end of a game frame: the stamp of the ADC sample that placed the car and the fence of the frame
+ *    (displaySubmit). With the display queue off, or nothing queued, the frame is already on the panel and is charged
+ *    right away
+ * 2. latencyPoll --> charge the frames whose fence is done: from the end of the ADC conversions to the end of the
+ *    transfer (displayDoneAt). Called every frame and once the queue is drained at the end of the game
+ * 3. Every frame updates count, total, max and a histogram of LATENCY_BIN_US bins; the last bin holds everything above
+ * 4. latencyReset --> forget every frame, when a game starts
+ * 5. latencyPercentile --> latency under which the fraction p of the frames falls (us), interpolated inside its bin and
+ *    never above the largest one measured
+ * 6. latencyDump --> print the statistics over the serial port, next to the profiler dump
+ *
+ * The filter of adcSampler.h is not counted: it delays a movement the same way whenever the sample is taken.
+ *
+ */
+#define LATENCY_BIN_US 50
+#define LATENCY_BINS 400 //Up to 20 ms
+#define LATENCY_PENDING 4 //Frames whose fence is not done yet
+
+typedef struct{
+  uint32_t frames;
+  uint64_t total_us;
+  uint32_t max_us;
+  uint16_t bins[LATENCY_BINS];
+}LatencyStats_t;
+
+typedef struct{
+  uint32_t fence;
+  uint32_t stamp_us; //End of the conversions of the sample
+}LatencyFrame_t;
+
+LatencyStats_t latencyStats;
+LatencyFrame_t latencyPending[LATENCY_PENDING];
+uint8_t latencyCount = 0;
+uint32_t latencyFence = 0; //Fence of the last frame
+
+/** Latency functions
+ *
+ * See Input Latency
+ *
+ */
+void latencyAdd(uint32_t us){
+  latencyStats.frames++;
+  latencyStats.total_us += us;
+  latencyStats.max_us = max(latencyStats.max_us, us);
+  uint16_t *bin = &latencyStats.bins[min(us/LATENCY_BIN_US, (uint32_t)(LATENCY_BINS-1))];
+  if(*bin < 0xFFFF){ (*bin)++; }
+}
+
+void latencyPoll(){
+  uint8_t k = 0;
+  while((k < latencyCount) && displayDone(latencyPending[k].fence)){
+    latencyAdd(displayDoneAt(latencyPending[k].fence) - latencyPending[k].stamp_us);
+    k++;
+  }
+  latencyCount -= k;
+  memmove(latencyPending, &latencyPending[k], latencyCount*sizeof(LatencyFrame_t));
+}
+
+void latencyFrame(uint32_t stamp_us, uint32_t fence){
+  bool queued = displayQueued && (fence != latencyFence); //Else nothing was queued: the frame is already on the panel
+  latencyFence = fence;
+  if(!queued){ latencyAdd(micros() - stamp_us); return; }
+  latencyPoll();
+  if(latencyCount >= LATENCY_PENDING){ return; } //The bus is behind: the frame is not measured
+  latencyPending[latencyCount].fence = fence;
+  latencyPending[latencyCount].stamp_us = stamp_us;
+  latencyCount++;
+}
+
+void latencyReset(){
+  memset(&latencyStats, 0, sizeof(latencyStats));
+  latencyCount = 0;
+}
+
+uint32_t latencyPercentile(double p){
+  double target = p*latencyStats.frames;
+  uint32_t seen = 0;
+  for(uint16_t b = 0; b < LATENCY_BINS; b++){
+    uint16_t n = latencyStats.bins[b];
+    if((n == 0) || (seen + n < target)){ seen += n; continue; }
+    uint32_t low = b*LATENCY_BIN_US; //Not above max_us: the bin holds a frame
+    uint32_t high = (b == LATENCY_BINS-1) ? latencyStats.max_us : min(low + LATENCY_BIN_US, latencyStats.max_us);
+    return low + (uint32_t)((high - low)*(target - seen)/n); //Frames spread evenly over the bin
+  }
+  return latencyStats.max_us;
+}
+
+void latencyDump(){
+  if(latencyStats.frames == 0){ return; }
+  Serial.print("latency,"); Serial.print(latencyStats.frames);
+  Serial.print(","); Serial.print((uint32_t)(latencyStats.total_us/latencyStats.frames));
+  Serial.print(","); Serial.print(latencyPercentile(0.5));
+  Serial.print(","); Serial.print(latencyPercentile(0.99));
+  Serial.print(","); Serial.println(latencyStats.max_us);
+}
@@ -0,0 +1,140 @@
+/**
+ * @file menuEngine.h
+ *
+ * @brief Table-driven settings menus: pages and options are const data, only the rows that change are redrawn
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/** Menu Engine
+ *
+ * 1. A page has a prompt and a list of options, every option has a label and the settings it writes when chosen
+ * 2. menuRun draws the page once, then only redraws the previously highlighted row and the new one when the cursor moves
+ * 3. Joystick navigation: a direction must be held MENU_SETTLE_MS before the first move, then repeats every
+ *    MENU_REPEAT_MS after MENU_REPEAT_DELAY_MS; back to the centre re-arms it
+ * 4. S2 applies the effects of the selected option through the apply callback, S1 leaves the settings untouched
+ * 5. Between two inputs the page sleeps (sleepUntilWake): a button event, the joystick crossing a threshold (adcWatch)
+ *    or the next auto-repeat wakes it, else IDLE_POLL_MS so that menuIdle serves the serial port; the joystick is sampled
+ *    every MENU_ADC_PERIOD_MS meanwhile
+ * 6. menuIdle, if set, is called before every sleep: background work that must not run during a game,
+ *    returning true while it has more to do (the page then checks the inputs and calls it again without sleeping)
+ *
+ */
+#define MENU_EFFECTS 7 //Max settings written by one option
+#define MENU_NONE 0 //Unused effect slot, so that tables can leave them out
+#define MENU_ROW_Y 60 //First option row
+#define MENU_ROW_STEP 15
+#define MENU_SETTLE_MS 30
+#define MENU_REPEAT_DELAY_MS 400
+#define MENU_REPEAT_MS 200
+#define MENU_ADC_PERIOD_MS 20 //Joystick sampling period while a page is shown
+#define MENU_JOY_DOWN 820 //Joystick Y below: cursor down (map() level under 20)
+#define MENU_JOY_UP 3317 //Joystick Y above: cursor up (map() level over 80)
+
+typedef struct{
+  uint8_t setting; //Setting id understood by the apply callback, MENU_NONE if unused
+  uint16_t value;
+}MenuEffect_t;
+
+typedef struct{
+  const char *label;
+  MenuEffect_t effects[MENU_EFFECTS];
+}MenuOption_t;
+
+typedef struct{
+  const char *prompt;
+  uint8_t promptX;
+  const MenuOption_t *options;
+  uint8_t numOptions;
+}MenuPage_t;
+
+typedef struct{
+  uint32_t pages; //Pages shown
+  uint32_t moves; //Cursor moves
+  uint32_t rowDraws; //Option rows drawn
+}MenuStats_t;
+
+MenuStats_t menuStats;
+bool (*menuIdle)(void) = NULL; //Work done while the menu waits for the player
+
+/** Menu row function
+ *
+ * Draw option i, highlighted when selected
+ *
+ */
+void menuDrawRow(const MenuPage_t *page, uint8_t i, bool selected){
+  textFontSolid(true);
+  textDraw(5, MENU_ROW_Y+MENU_ROW_STEP*i, page->options[i].label, blackColour, selected ? yellowColour : whiteColour);
+  textFontSolid(false);
+  menuStats.rowDraws++;
+}
+
+/** Menu run function
+ *
+ * Show page with the first option selected and return the button that closed it (BUTTON_S1 or BUTTON_S2).
+ * On BUTTON_S2 every effect of the selected option is passed to apply.
+ *
+ */
+uint8_t menuRun(const MenuPage_t *page, void (*apply)(uint8_t setting, uint16_t value)){
+  uint8_t cursor = 0;
+  myScreen.clear(whiteColour);
+  textDraw(15,15, "SETTINGS", redColour, whiteColour, 2, 2);
+  textDraw(page->promptX,45, page->prompt, blackColour);
+  textDraw(2, myScreen.screenSizeY()-10, "Back", blackColour);
+  textDraw(102, myScreen.screenSizeY()-10, "Next", blackColour);
+  for(uint8_t i = 0; i < page->numOptions; i++){ menuDrawRow(page, i, i == cursor); }
+  menuStats.pages++;
+  adcSetPeriod(MENU_ADC_PERIOD_MS);
+  adcWatch(ADC_JOY_Y, MENU_JOY_DOWN, MENU_JOY_UP);
+
+  int8_t held = 0; //Direction held: -1 up, +1 down
+  uint32_t heldSince = 0;
+  uint32_t nextMove = 0;
+
+  while(1){
+    //Select option with analog
+    uint16_t joy = adcRead(ADC_JOY_Y);
+    int8_t dir = (joy < MENU_JOY_DOWN) ? 1 : ((joy > MENU_JOY_UP) ? -1 : 0);
+    uint32_t now = millis();
+    if(dir != held){
+      held = dir;
+      heldSince = now;
+      nextMove = now + MENU_SETTLE_MS;
+    }
+    if((held != 0) && ((int32_t)(now - nextMove) >= 0)){
+      nextMove = now + ((now - heldSince < MENU_REPEAT_DELAY_MS) ? MENU_REPEAT_DELAY_MS - MENU_SETTLE_MS : MENU_REPEAT_MS);
+      int8_t next = cursor + held;
+      if((next >= 0) && (next < page->numOptions)){ //Redraw only the two rows involved
+        menuDrawRow(page, cursor, false);
+        cursor = next;
+        menuDrawRow(page, cursor, true);
+        menuStats.moves++;
+      }
+    }
+
+    //Manage "back" and "next" buttons: their text background turns yellow
+    uint8_t button = buttonPressed();
+    if(button == BUTTON_S1){
+      adcWatch(ADC_NO_WATCH, 0, 0);
+      textFontSolid(true);
+      textDraw(2, myScreen.screenSizeY()-10, "Back", blackColour, yellowColour);
+      textFontSolid(false);
+      return BUTTON_S1;
+    }
+    if(button == BUTTON_S2){
+      adcWatch(ADC_NO_WATCH, 0, 0);
+      textFontSolid(true);
+      textDraw(102, myScreen.screenSizeY()-10, "Next", blackColour, yellowColour);
+      textFontSolid(false);
+      const MenuOption_t *option = &page->options[cursor];
+      for(uint8_t k = 0; k < MENU_EFFECTS; k++){
+        if(option->effects[k].setting != MENU_NONE){ apply(option->effects[k].setting, option->effects[k].value); }
+      }
+      return BUTTON_S2;
+    }
+
+    //Nothing to draw: sleep until an input changes, the next auto-repeat is due or the serial port must be looked at
+    if((menuIdle != NULL) && menuIdle()){ continue; }
+    sleepUntilWake((held != 0) ? max((int32_t)(nextMove - millis()), (int32_t)1) : IDLE_POLL_MS);
+  }
+}
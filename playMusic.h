@@ -70,44 +70,121 @@ int noteDurations[] = {
   3,3,4,4,2,2,2,2,1
 };
 
-/** Play music function
+/** 
+ * Definition of the countdown beeps: three short D4 and a long G4, one per second
+ */
+int countdownMelody[] = {NOTE_D4, NOTE_D4, NOTE_D4, NOTE_G4};
+int countdownDurations[] = {2, 2, 2, 1};
+
+/** Music Sequencer
+ * 
+ * Songs are played by a Clock callback, so the caller keeps running while the buzzer plays:
+ * 1. Every note is started with tone(frequency, 1000/duration ms), which stops by itself
+ * 2. The callback is rescheduled one-shot at the start of the next note (note length + gap), nothing runs in between
+ * 3. musicPlay replaces what is playing, musicQueue appends up to MUSIC_QUEUE songs, musicStop silences the buzzer
+ * 
+ * State shared with the callback is only changed with interrupts disabled.
+ * 
+ */
+#define MUSIC_QUEUE 4
+
+typedef struct{
+  const int *notes;
+  const int *durations; //Note lengths as fractions of a second (4 = quarter)
+  uint8_t length;
+  uint16_t gap; //Silence after every note (ms)
+}Song_t;
+
+const Song_t introSong = {melody, noteDurations, N_NOTES-1, 50};
+const Song_t countdownSong = {countdownMelody, countdownDurations, 4, 500};
+
+Clock musicClock;
+const Song_t *volatile musicQueueSongs[MUSIC_QUEUE];
+volatile uint8_t musicQueueHead = 0; //Song being played
+volatile uint8_t musicQueueCount = 0; //Songs in the queue, the one being played included
+volatile uint8_t musicNote = 0; //Next note of the current song
+
+/** Music tick function
  * 
- * Play the intro music using the melody and note durations
+ * Clock callback: start the next note and reschedule at its end, move to the next song when the current one is over
  * 
  */
-void playMusic(){
-  pinMode(buzzerPin,OUTPUT);
-  for (int thisNote = 0; thisNote < N_NOTES-1; thisNote++) {
-    int noteDuration = 1000/noteDurations[thisNote];
-    tone(buzzerPin, melody[thisNote],noteDuration);
-
-    int pauseBetweenNotes = noteDuration + 50; //Delay between notes
-    delay(pauseBetweenNotes);
-    
-    noTone(buzzerPin); //Stop the tone playing
+void musicTick(){
+  while(musicQueueCount > 0){
+    const Song_t *song = musicQueueSongs[musicQueueHead];
+    if(musicNote < song->length){
+      uint16_t noteDuration = 1000/song->durations[musicNote];
+      tone(buzzerPin, song->notes[musicNote], noteDuration);
+      musicNote++;
+      musicClock.setTimeout(noteDuration + song->gap);
+      musicClock.start();
+      return;
+    }
+    musicQueueHead = (musicQueueHead+1) % MUSIC_QUEUE; //Song over
+    musicQueueCount--;
+    musicNote = 0;
   }
+  noTone(buzzerPin);
+}
+
+/** Music functions
+ * 
+ * 1. musicBegin --> setup buzzer pin and sequencer clock
+ * 2. musicPlay --> stop the current song, clear the queue and play song now
+ * 3. musicQueue --> play song after the queued ones, returns false if the queue is full
+ * 4. musicStop --> silence the buzzer and clear the queue
+ * 5. musicPlaying --> true until the last queued song is over
+ * 
+ */
+void musicBegin(){
+  pinMode(buzzerPin, OUTPUT);
+  musicClock.begin(musicTick, 1, 0);
+}
+
+void musicStop(){
+  noInterrupts();
+  musicClock.stop();
+  musicQueueCount = 0;
+  musicNote = 0;
+  interrupts();
+  noTone(buzzerPin);
+}
+
+bool musicQueue(const Song_t *song){
+  noInterrupts();
+  if(musicQueueCount == MUSIC_QUEUE){ interrupts(); return false; }
+  musicQueueSongs[(musicQueueHead + musicQueueCount) % MUSIC_QUEUE] = song;
+  musicQueueCount++;
+  if(musicQueueCount == 1){ musicNote = 0; musicTick(); } //Sequencer was idle: start right away
+  interrupts();
+  return true;
+}
+
+void musicPlay(const Song_t *song){
+  musicStop();
+  musicQueue(song);
+}
+
+bool musicPlaying(){
+  return musicQueueCount > 0;
 }
 
 /** CountDown function
  * 
- * Diplay a countdown (3, 2, 1, GO!) on LCD and play sound 
+ * Diplay a countdown (3, 2, 1, GO!) on LCD while the sequencer plays the beeps
  * 
  */
 void countDown(){
-    myScreen.clear(whiteColour);
-    for(int i = 3; i > 0; i--){
-      myScreen.gText(myScreen.screenSizeX()/2-25,myScreen.screenSizeY()/2-25, (String)i, redColour, whiteColour, 7, 7);
-      int noteDuration = 1000/2;
-      tone(buzzerPin, NOTE_D4, noteDuration);
-      delay(1000);
+    musicPlay(&countdownSong);
+    uint32_t start = millis();
+    for(int i = 3; i >= 0; i--){
       myScreen.clear(whiteColour);
-    }
-    myScreen.gText(2,myScreen.screenSizeY()/2-25, "GO!", redColour, whiteColour, 7, 7);
-    int noteDuration = 1000/1;
-    tone(buzzerPin, NOTE_G4,noteDuration);
-    delay(1000);
-    noTone(buzzerPin);
+      char digit[2] = {(char)('0'+i), 0};
+      if(i > 0){ textDraw(myScreen.screenSizeX()/2-25,myScreen.screenSizeY()/2-25, digit, redColour, whiteColour, 7, 7); }
+      else{ textDraw(2,myScreen.screenSizeY()/2-25, "GO!", redColour, whiteColour, 7, 7); }
 
-    delay(1);
+      uint32_t elapsed = millis() - start; //Hold every page until its second is over
+      if(elapsed < (uint32_t)(4-i)*1000){ delay((4-i)*1000 - elapsed); }
+    }
     myScreen.clear(blackColour);
 }
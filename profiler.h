@@ -0,0 +1,207 @@
+/**
+ * @file profiler.h
+ *
+ * @brief Per-phase cycle profiler: cycle counts per FSM state and phase, with min/max/mean, histograms and a ring of the latest samples
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/** Profiler
+ *
+ * 1. profState is the FSM state being run, set with PROF_STATE(s) by loop() before every state function
+ * 2. PROF_PHASE(p) closes the running phase and opens p, PROF_END() closes the running phase: consecutive phases
+ *    share their boundary, so a frame costs one cycle counter read per phase
+ * 3. PROF_SCOPE(p) times the enclosing block, whatever way it is left
+ * 4. Every closed phase updates count, min, max, total and a histogram (bucket b holds samples of 2^(b-1) to 2^b - 1
+ *    cycles) of its (state, phase) pair, and is stored in a ring of the last PROF_RING samples
+ * 5. Scopes also add up their wall time: the cycle counter stops while the CPU sleeps, so the active cycles of a whole
+ *    state over its wall time (at CPU_HZ) is the fraction of time the CPU was awake in that state
+ * 6. profDump prints everything over the serial port when 'p' is received while waiting for a button, and at every game
+ *    over with PROF_GAME_OVER_DUMP (about 225 ms of busy CPU at PROF_BAUD, charged to the game over state)
+ * 7. The counters are reset when a game starts (fn_STATE_INIT_GAME), so at game over they hold that game only
+ *
+ * With PROFILER 0 the macros expand to nothing and no RAM is used.
+ *
+ */
+#ifndef PROFILER
+#define PROFILER 1 //Cheap enough to stay on in release builds
+#endif
+#define PROF_STATES 9 //One row per FSM state
+#define PROF_BUCKETS 24 //Last bucket holds everything from 2^22 cycles (~87 ms) up
+#define PROF_RING 128 //Power of two
+#define PROF_BAUD 115200
+#ifndef PROF_GAME_OVER_DUMP
+#define PROF_GAME_OVER_DUMP 0 //1: dump at every game over, 0: only on 'p'
+#endif
+
+typedef enum{
+  PHASE_STATE, //Whole state function
+  PHASE_INPUT, //Scheduler, buttons, ADC and session
+  PHASE_CAR, //Car position and damage
+  PHASE_SPAWN, //Block spawning (one sample per simulation step)
+  PHASE_MOTION, //Block motion and score
+  PHASE_COLLISION, //Broadphase and swept collision
+  PHASE_HUD, //Score text and its damage
+  PHASE_DRAW, //Block damage, scene description and flush
+  PHASE_WAIT, //Sleep until the next frame
+  PROF_PHASES
+}ProfPhase_t;
+
+typedef struct{
+  uint32_t count;
+  uint32_t min, max;
+  uint64_t total;
+  uint64_t wall_us; //Scopes only: wall time, sleep included
+  uint16_t hist[PROF_BUCKETS];
+}ProfStats_t;
+
+typedef struct{
+  uint8_t state, phase;
+  uint32_t cycles;
+}ProfSample_t;
+
+#if PROFILER
+const char *const profPhaseNames[PROF_PHASES] = {"state", "input", "car", "spawn", "motion", "collision", "hud", "draw", "wait"};
+
+ProfStats_t profStats[PROF_STATES][PROF_PHASES];
+ProfSample_t profRing[PROF_RING];
+uint32_t profRingHead = 0; //Samples written since the last reset
+uint8_t profState = 0;
+uint8_t profPhase = PROF_PHASES; //Running phase, PROF_PHASES if none
+uint32_t profStart = 0;
+
+/** Record functions
+ *
+ * 1. profRecord --> add a sample of phase p in the current state
+ * 2. profMark --> close the running phase (if any) and open p (PROF_PHASES opens nothing)
+ *
+ */
+void profRecord(uint8_t p, uint32_t cycles){
+  if(profState >= PROF_STATES){ return; }
+  ProfStats_t *st = &profStats[profState][p];
+  if((st->count == 0) || (cycles < st->min)){ st->min = cycles; }
+  if(cycles > st->max){ st->max = cycles; }
+  st->count++;
+  st->total += cycles;
+  uint8_t b = (cycles == 0) ? 0 : 32 - __builtin_clz(cycles); //CLZ on the Cortex-M4
+  st->hist[min(b, PROF_BUCKETS-1)]++;
+
+  ProfSample_t *s = &profRing[profRingHead++ % PROF_RING];
+  s->state = profState;
+  s->phase = p;
+  s->cycles = cycles;
+}
+
+void profMark(uint8_t p){
+  uint32_t now = cycleCount();
+  if(profPhase < PROF_PHASES){ profRecord(profPhase, now - profStart); }
+  profPhase = p;
+  profStart = now;
+}
+
+/** Scope class
+ *
+ * Time the enclosing block as phase p, independently from the marks
+ *
+ */
+class ProfScope{
+public:
+  ProfScope(uint8_t p){ _phase = p; _state = profState; _start = cycleCount(); _startUs = micros(); }
+  ~ProfScope(){
+    uint32_t cycles = cycleCount() - _start;
+    uint8_t state = profState;
+    profState = _state; //Charge the state that opened the scope
+    profRecord(_phase, cycles);
+    if(_state < PROF_STATES){ profStats[_state][_phase].wall_us += micros() - _startUs; }
+    profState = state;
+  }
+private:
+  uint8_t _phase, _state;
+  uint32_t _start, _startUs;
+};
+
+/** Control functions
+ *
+ * 1. profBegin --> start the cycle counter and the serial port
+ * 2. profReset --> forget every sample
+ * 3. profDump --> print the statistics of every (state, phase) pair seen, the active fraction of every state and the ring,
+ *    oldest sample first: "prof,<state>,<phase>,<count>,<min>,<max>,<mean>,<first bucket>,<bucket counts...>",
+ *    "power,<state>,<wall us>,<active cycles>,<active per mille>" and "ring,<state>,<phase>,<cycles>"
+ * 4. profPoll --> serial commands: 'p' dumps, 'r' resets; returns the last command served, 0 if none
+ *
+ */
+void profBegin(){
+  cycleCounterBegin();
+  Serial.begin(PROF_BAUD);
+}
+
+void profReset(){
+  memset(profStats, 0, sizeof(profStats));
+  profRingHead = 0;
+  profPhase = PROF_PHASES;
+}
+
+void profDump(){
+  Serial.print("prof,cpu_hz,");
+  Serial.println(CPU_HZ);
+  for(uint8_t s = 0; s < PROF_STATES; s++){
+    for(uint8_t p = 0; p < PROF_PHASES; p++){
+      ProfStats_t *st = &profStats[s][p];
+      if(st->count == 0){ continue; }
+      uint8_t first = 0, last = PROF_BUCKETS-1;
+      while(st->hist[first] == 0){ first++; }
+      while(st->hist[last] == 0){ last--; }
+      Serial.print("prof,"); Serial.print(s);
+      Serial.print(","); Serial.print(profPhaseNames[p]);
+      Serial.print(","); Serial.print(st->count);
+      Serial.print(","); Serial.print(st->min);
+      Serial.print(","); Serial.print(st->max);
+      Serial.print(","); Serial.print((uint32_t)(st->total/st->count));
+      Serial.print(","); Serial.print(first);
+      for(uint8_t b = first; b <= last; b++){ Serial.print(","); Serial.print(st->hist[b]); }
+      Serial.println();
+    }
+  }
+  for(uint8_t s = 0; s < PROF_STATES; s++){
+    ProfStats_t *st = &profStats[s][PHASE_STATE];
+    if(st->wall_us == 0){ continue; }
+    Serial.print("power,"); Serial.print(s);
+    Serial.print(","); Serial.print((uint32_t)st->wall_us);
+    Serial.print(","); Serial.print((uint32_t)st->total);
+    Serial.print(","); Serial.println((uint32_t)min(st->total*1000/(st->wall_us*(CPU_HZ/1000000)), (uint64_t)1000));
+  }
+  uint32_t n = min(profRingHead, (uint32_t)PROF_RING);
+  for(uint32_t k = profRingHead - n; k != profRingHead; k++){
+    ProfSample_t *smp = &profRing[k % PROF_RING];
+    Serial.print("ring,"); Serial.print(smp->state);
+    Serial.print(","); Serial.print(profPhaseNames[smp->phase]);
+    Serial.print(","); Serial.println(smp->cycles);
+  }
+}
+
+char profPoll(){
+  char served = 0;
+  while(Serial.available() > 0){
+    int c = Serial.read();
+    if(c == 'p'){ profDump(); served = c; }
+    if(c == 'r'){ profReset(); served = c; }
+  }
+  return served;
+}
+
+#define PROF_STATE(s) (profState = (s))
+#define PROF_PHASE(p) profMark(p)
+#define PROF_END() profMark(PROF_PHASES)
+#define PROF_SCOPE_NAME(line) profScope##line
+#define PROF_SCOPE_LINE(p, line) ProfScope PROF_SCOPE_NAME(line)(p)
+#define PROF_SCOPE(p) PROF_SCOPE_LINE(p, __LINE__)
+#else
+#define PROF_STATE(s)
+#define PROF_PHASE(p)
+#define PROF_END()
+#define PROF_SCOPE(p)
+void profBegin(){}
+void profReset(){}
+void profDump(){}
+char profPoll(){ return 0; }
+#endif
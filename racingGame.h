@@ -6,32 +6,33 @@
  * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
  */
  
-#include <LCD_screen.h>
-#include <LCD_screen_font.h>
-#include <LCD_utilities.h>
-#include <Screen_HX8353E.h>
-Screen_HX8353E myScreen;
+#include "hal.h"
 
+#include "colours.h"
+#include "displayQueue.h"
+#include "assetCodec.h"
 #include "displayLogo.h"
+#include "frameScheduler.h"
+#include "sprites.h"
+#include "carSprites.h"
+#include "compositor.h"
+#include "textRenderer.h"
 #include "playMusic.h"
+#include "bandRenderer.h"
+#include "buttonEvents.h"
+#include "adcSampler.h"
+#include "menuEngine.h"
+#include "fixedPoint.h"
+#include "blockPool.h"
+#include "sessionRecorder.h"
+#include "profiler.h"
+#include "inputLatency.h"
+#include "scoreStore.h"
 
 /** 
- * Definition of colors used to draw on the screen
+ * Blocks colors (palette indices)
  */
-#define greyColour myScreen.calculateColour(128, 128, 128)
-#define orangeColour myScreen.calculateColour(255, 128, 0)
-#define cyanColour myScreen.calculateColour(0, 255, 255)
-#define magentaColour myScreen.calculateColour(255, 0, 255)
-#define violetColour myScreen.calculateColour(138, 43, 226)
-#define pinkColour myScreen.calculateColour(245, 185, 185)
-#define yellowColour myScreen.calculateColour(255, 255, 0)
-#define springGreen myScreen.calculateColour(0, 255, 127)
-#define deepPinkColour myScreen.calculateColour(255, 20, 147)
-#define turquoiseColour myScreen.calculateColour(0, 206, 209)
-#define darkGreenColour myScreen.calculateColour(0, 100, 0)
-#define peachPuffColour myScreen.calculateColour(255, 218, 155)
-
-int colors[10]={cyanColour, magentaColour, violetColour, pinkColour, yellowColour, springGreen, deepPinkColour, turquoiseColour, darkGreenColour, peachPuffColour};
+const uint8_t colors[10]={PAL_CYAN, PAL_MAGENTA, PAL_VIOLET, PAL_PINK, PAL_YELLOW, PAL_SPRING_GREEN, PAL_DEEP_PINK, PAL_TURQUOISE, PAL_DARK_GREEN, PAL_PEACH_PUFF};
 
 /** 
  * Definition of analog pin constans
@@ -45,22 +46,29 @@ const uint8_t redLED = 39;
 /** Buttons Management
  * 
  * 1. Variables definition
- * 2. CheckButtons --> loop that check for both button S1 and S2 and sets triggeredButton variable by consequence
+ * 2. idleWork --> work done while waiting for the player: profiler commands and one pending high-score write;
+ *    returns true while there is more to do
+ * 3. idleWait --> idleWork, then sleep until a button event, or IDLE_POLL_MS to look at the serial port again
+ * 4. CheckButtons --> wait for the next press event of S1 or S2 and set triggeredButton variable by consequence, in idleWait
  * 
  */
 const uint8_t buttonOne = 33;
 const uint8_t buttonTwo = 32;
 
-uint8_t buttonOneState = 0;
-uint8_t buttonTwoState = 0;
-
 uint8_t triggeredButton = 0;
 
+bool idleWork(){
+  if(profPoll() == 'p'){ latencyDump(); } //Serial commands of the profiler, with the latency of the last game
+  return scoreStoreIdle(); //Never called by the game loop: flash writes stall the CPU
+}
+
+void idleWait(){
+  if(idleWork()){ return; } //Check the inputs, then go on with the work
+  sleepUntilWake(IDLE_POLL_MS);
+}
+
 void checkButtons(){
-  while(1){
-    if(digitalRead(buttonOne) == LOW){ triggeredButton = 1; break; } 
-    if(digitalRead(buttonTwo) == LOW){ triggeredButton = 2; break; }
-  }
+  while((triggeredButton = buttonPressed()) == 0){ idleWait(); }
 }
 
 //----------------------------------------Game Management---------------------------------------
@@ -72,51 +80,176 @@ const uint8_t carHeight = 5; //Height of the car from the bottom edge of the scr
 const uint8_t carWidth = 10; //Width of the car
 const uint8_t carLength = 22; //Lenght of the car
 const uint8_t tyreDim = 5; //Tyre dimension (square)
-const uint8_t blockDim = 10; //Blocks dimension (square)
+const uint8_t blockDim = BLOCK_SIZE; //Blocks dimension (square)
 const uint8_t offset = 30; //Y-Axis offset
 
 /**
- * Blocks constant definition
+ * Blocks variables definition (blocks themselves live in blockPool.h)
  */
-#define MAX_BLOCKS 7
-uint8_t x_block[MAX_BLOCKS], y_block[MAX_BLOCKS], b_color[MAX_BLOCKS];
-uint8_t current_n_blocks = 0;
+uint16_t blockSpawns = 0; //Blocks spawned in this game, picks the colour of the next one
+uint16_t blockHits[BLOCK_POOL_SIZE];
 
 /**
  * Car coordinates definition
  */
 uint8_t x00, y00;
+CompRect_t carDrawn; //Where the car image is on screen
 uint8_t x = myScreen.screenSizeX()/2;
 uint8_t y = myScreen.screenSizeY()-offset;
 
 /**
  * Game variables definition
  */
-uint8_t record = 0; //Score record of the session (until settings reset)
+uint8_t record = 0; //Best score saved for the current settings (scoreStore.h)
 uint8_t score = 0; //Current game score
 uint8_t tmp_score = 0;
-uint8_t timer = 0; //Time to wait before random spawning
-uint8_t vel = 0; //Block's falling velocity
+uint32_t timer = 0; //Time since the last spawn try was due (us): a try is made in the step it falls below FRAME_PERIOD_US
+uint8_t vel = 0; //Speed level, starts from vel00 and grows with the score
+q16_t speed = 0; //Block's falling speed (pixels per game tick), eases towards speedTarget
+q16_t speedTarget = 0; //Speed of the current level
+q16_t stepVel = 0; //Block's falling velocity (pixels per simulation step)
 bool collision = false;
+uint32_t ledOffTime = 0; //When the speed-up redLED blink ends (ms)
+bool ledOn = false;
+q16_t roadFall = 0; //Road travel not scrolled yet: a fraction of a row, a few rows within a frame
+uint16_t roadRows = 0; //Rows scrolled since the start of the game (only its phase is used)
+
+/**
+ * Game timing definition
+ */
+#define GAME_TICK_US 100000UL //vel and waitTime are expressed in game ticks of 100 ms, independently from FRAME_RATE_HZ
+#define STEP_PER_TICK Q16_FRAC(FRAME_PERIOD_US, GAME_TICK_US) //Game ticks in a simulation step
+#define SPEED_EASE_SHIFT 4 //Every step the speed covers 1/16 of the way to the level speed
+FrameScheduler_t gameFrames;
+
+/**
+ * Intro timing definition
+ */
+#define LOGO_HOLD_MS 3000 //Time the logo stays on screen, the intro music goes on under the menus
+
+/**
+ * Game rendering definition
+ */
+#define RENDER_DAMAGE 0 //Damaged regions pushed one window each (compositor.h)
+#define RENDER_BANDS 1 //Damaged bands rendered off-screen and pushed one window each (bandRenderer.h)
+#ifndef RENDER_MODE
+#define RENDER_MODE RENDER_DAMAGE
+#endif
+#ifndef ROAD_SCROLL
+#define ROAD_SCROLL 1 //1: kerbs and lane lines moving with the blocks through the panel scroll, 0: plain static road
+#endif
+#ifndef DISPLAY_ASYNC
+#define DISPLAY_ASYNC 1 //1: game frames queued and sent by the DMA while the next one is computed (displayQueue.h), 0: blocking
+#endif
+#ifndef LATE_LATCH
+#define LATE_LATCH 1 //1: steering sampled after the blocks are drawn, car drawn last, 0: sampled at the start of the frame
+#endif
+#define ROAD_TOP 10 //Rows above the scroll area, holding the score
+#define ROAD_PERIOD 16 //Rows of one kerb and lane line pattern
+#define KERB_WIDTH 3 //Kerb columns inside each grass strip
+TextHud_t scoreHud; //Score printed in the HUD
 
 //----------------------------------------Selection Menu----------------------------------------
 #define N_cars 3
 #define N_diff 3
 #define N_modes 2
 
-uint8_t cursor = 0;
+/**
+ * Settings written by the menus (MENU_NONE is 0)
+ */
+typedef enum{
+  SET_CAR_COLOUR = 1,
+  SET_VEL,
+  SET_WAIT_TIME,
+  SET_UPPER_RANDOM,
+  SET_COLLECT_POINTS,
+  SET_BLOCKS_NUMBER,
+  SET_DRIVE_MODE,
+  SET_SPEED_GAIN,
+  SET_CAR_SPRITE,
+  SET_DIFFICULTY
+}Setting_t;
 
-String carOptions[N_cars] = {"- Ferrari","- RedBull","- McLaren"};
-String difficultyOptions[N_diff] = {"- Rookie","- Champion","- Legend"};
-String modeOptions[N_modes] = {"- Joystick","- Accelerometer"};
+/**
+ * Menu pages: options and the settings they write
+ */
+const MenuOption_t carOptions[N_cars] = {
+  {"- Ferrari", {{SET_CAR_COLOUR, redColour}, {SET_CAR_SPRITE, 0}}},
+  {"- RedBull", {{SET_CAR_COLOUR, blueColour}, {SET_CAR_SPRITE, 1}}},
+  {"- McLaren", {{SET_CAR_COLOUR, orangeColour}, {SET_CAR_SPRITE, 2}}}
+};
+/**
+ * Difficulty presets: constants known to the compiler, the game step is specialized for each of them
+ */
+typedef struct{
+  uint8_t vel00, waitTime, upperRandom, collectPoints, blocksNumber;
+  uint16_t speedGain;
+}DifficultyProfile_t;
+
+constexpr DifficultyProfile_t difficultyProfiles[N_diff] = {
+  {1, 40, 30, 5, 5, 192}, //Rookie
+  {2, 35, 30, 6, 7, 256}, //Champion
+  {3, 35, 40, 5, 7, 320} //Legend
+};
+#define DIFFICULTY_EFFECTS(d) {{SET_VEL, difficultyProfiles[d].vel00}, {SET_WAIT_TIME, difficultyProfiles[d].waitTime}, \
+  {SET_UPPER_RANDOM, difficultyProfiles[d].upperRandom}, {SET_COLLECT_POINTS, difficultyProfiles[d].collectPoints}, \
+  {SET_BLOCKS_NUMBER, difficultyProfiles[d].blocksNumber}, {SET_SPEED_GAIN, difficultyProfiles[d].speedGain}, {SET_DIFFICULTY, d}}
+
+const MenuOption_t difficultyOptions[N_diff] = {
+  {"- Rookie", DIFFICULTY_EFFECTS(0)},
+  {"- Champion", DIFFICULTY_EFFECTS(1)},
+  {"- Legend", DIFFICULTY_EFFECTS(2)}
+};
+const MenuOption_t modeOptions[N_modes] = {
+  {"- Joystick", {{SET_DRIVE_MODE, true}}},
+  {"- Accelerometer", {{SET_DRIVE_MODE, false}}}
+};
+
+const MenuPage_t carPage = {"Choose your car:", 1, carOptions, N_cars};
+const MenuPage_t difficultyPage = {"Select difficulty:", 1, difficultyOptions, N_diff};
+const MenuPage_t modePage = {"Select drive mode:", 2, modeOptions, N_modes};
 
 int carColor = redColour;
+uint8_t carSprite = 0; //Artwork of the car (carSprites.h)
+uint8_t difficulty = 0; //Difficulty option chosen
 uint8_t vel00 = 1; //Block's initial falling velocity (1, 2, 3)
 uint8_t waitTime = 40; //Time between spawn try (40, 35, 35)
 uint8_t upperRandom = 30; //Upper bound of spawn probability (30, 30, 30)
 uint8_t collectPoints = 5; //Points after which the speed increases (5, 6, 5)
 uint8_t blocksNumber = 5; //Max number of blocks on screen (5, 7, 7)
+uint16_t speedGain = 192; //Speed added by every level, 1/256 pixels per game tick (192, 256, 320)
 bool driveMode = true; //Drive mode: true = analog, false = accelerometer
+bool lateLatch = LATE_LATCH; //Steering sampled right before the car is drawn
+
+/** Apply setting function
+ * 
+ * Menu callback: write the value chosen in a menu page into the matching game setting
+ * 
+ */
+void applySetting(uint8_t setting, uint16_t value){
+  switch(setting){
+    case SET_CAR_COLOUR: carColor = value; break;
+    case SET_VEL: vel00 = value; break;
+    case SET_WAIT_TIME: waitTime = value; break;
+    case SET_UPPER_RANDOM: upperRandom = value; break;
+    case SET_COLLECT_POINTS: collectPoints = value; break;
+    case SET_BLOCKS_NUMBER: blocksNumber = value; break;
+    case SET_DRIVE_MODE: driveMode = (value != 0); break;
+    case SET_SPEED_GAIN: speedGain = value; break;
+    case SET_CAR_SPRITE: carSprite = value % CAR_SPRITES; break;
+    case SET_DIFFICULTY: difficulty = value % N_diff; break;
+  }
+}
+
+/** Score key function
+ * 
+ * Key of the current settings in the high-score store: one best score per car, difficulty and drive mode
+ * 
+ */
+uint8_t scoreKey(){
+  return (carSprite*N_diff + difficulty)*N_modes + (driveMode ? 0 : 1);
+}
+static_assert(CAR_SPRITES*N_diff*N_modes <= STORE_KEYS, "too many settings for the high-score store");
 
 //--------------------------------------FSM Definition--------------------------------------
 #define NUM_STATES 9
@@ -176,7 +309,7 @@ StateMachine_t fsm[] = {
 
 /** FSM Function Definitions
  * 
- * 1. STATE_INIT --> init state where displayLogo and playMusic functions are called
+ * 1. STATE_INIT --> init state where the intro music is started and the logo is displayed while it plays
  * 2. CMD_MENU --> command menu state shows on LCD display commands in order to move through settings menu
  * 3. SEL_CAR --> select car state displays three car option to choose
  * 4. SEL_DIFF --> select difficulty state displays three difficulty option to choose
@@ -188,31 +321,37 @@ StateMachine_t fsm[] = {
  * 
  */
 void fn_STATE_INIT(){
+  uint32_t start = millis();
+  adcSetPeriod(0); //Joystick and accelerometer are only sampled by the pages that read them
+  musicPlay(&introSong);
   displayLogo();
-  playMusic();
+  uint32_t elapsed = millis() - start;
+  if(elapsed < LOGO_HOLD_MS){ delay(LOGO_HOLD_MS - elapsed); }
   current_state = STATE_CMD_MENU;
 }
 
 void fn_STATE_CMD_MENU(){
+  adcSetPeriod(0);
+
   //Print how to navigate settings
   myScreen.clear(whiteColour);
-  myScreen.setFontSolid(false);
-  myScreen.gText(10,15, "Menu Cmds", redColour, whiteColour, 2, 2);
-  myScreen.gText(1,45, "- Move the analog to", blackColour);
-  myScreen.gText(1,55, "  select the option.", blackColour);
-  myScreen.gText(1,70, "- Press S1 to go to", blackColour);
-  myScreen.gText(1,80, "  previous page.", blackColour);
-  myScreen.gText(1,95, "- Press S2 to go to", blackColour);
-  myScreen.gText(1,105, "  next page.", blackColour);
-  myScreen.gText(102, myScreen.screenSizeY()-10, "Next", blackColour, yellowColour);
+  textFontSolid(false);
+  textDraw(10,15, "Menu Cmds", redColour, whiteColour, 2, 2);
+  textDraw(1,45, "- Move the analog to", blackColour);
+  textDraw(1,55, "  select the option.", blackColour);
+  textDraw(1,70, "- Press S1 to go to", blackColour);
+  textDraw(1,80, "  previous page.", blackColour);
+  textDraw(1,95, "- Press S2 to go to", blackColour);
+  textDraw(1,105, "  next page.", blackColour);
+  textDraw(102, myScreen.screenSizeY()-10, "Next", blackColour, yellowColour);
 
   while(1){
     //Manage "next" button
-    buttonTwoState = digitalRead(buttonTwo); //Read the state of ButtonTwo (S2)
-    if(buttonTwoState == LOW){  //If S2 is pressed, "next" text background turns yellow
-      myScreen.setFontSolid(true);
-      myScreen.gText(102, myScreen.screenSizeY()-10, "Next", blackColour, yellowColour);
-      myScreen.setFontSolid(false);
+    checkButtons(); //Sleep until S1 or S2 is pressed
+    if(triggeredButton == BUTTON_S2){  //If S2 is pressed, "next" text background turns yellow
+      textFontSolid(true);
+      textDraw(102, myScreen.screenSizeY()-10, "Next", blackColour, yellowColour);
+      textFontSolid(false);
       current_state = STATE_SEL_CAR; //Go to next page
       return;
     }
@@ -220,380 +359,474 @@ void fn_STATE_CMD_MENU(){
 }
 
 void fn_STATE_SEL_CAR(){
-  //After game over and S1, reset record 
-  record = 0;
-
-  //Print titles and buttons
-  myScreen.clear(whiteColour);
-  myScreen.gText(15,15, "SETTINGS", redColour, whiteColour, 2, 2);
-  myScreen.gText(1,45, "Choose your car:", blackColour);
-  myScreen.gText(2, myScreen.screenSizeY()-10, "Back", blackColour);
-  myScreen.gText(102, myScreen.screenSizeY()-10, "Next", blackColour);
-
-  cursor = 0;
- 
-  while(1){  
-    
-    //Select option with analog
-    if(map(analogRead(joystickY), 0, 4096, 0, 100) < 20){
-      if(cursor < N_cars-1){ cursor++; }
-      else{ cursor = N_cars; }
-    }
-    else if(map(analogRead(joystickY), 0, 4096, 0, 100) > 80){
-      if(cursor>0){cursor--;}
-      else{cursor = 0;}
-    }
-    
-    //Highlight selected option
-    myScreen.setFontSolid(true);
-    if(cursor == 0){
-      myScreen.gText(5,60+15*0, carOptions[0], blackColour, yellowColour);        
-      myScreen.gText(5,60+15*1, carOptions[1], blackColour, whiteColour);
-      myScreen.gText(5,60+15*2, carOptions[2], blackColour, whiteColour);
-    }
-    else if(cursor == 1){
-      myScreen.gText(5,60+15*1, carOptions[1], blackColour, yellowColour);
-      myScreen.gText(5,60+15*0, carOptions[0], blackColour, whiteColour);
-      myScreen.gText(5,60+15*2, carOptions[2], blackColour, whiteColour);
-    }
-    else{
-      myScreen.gText(5,60+15*2, carOptions[2], blackColour, yellowColour);
-      myScreen.gText(5,60+15*1, carOptions[1], blackColour, whiteColour);
-      myScreen.gText(5,60+15*0, carOptions[0], blackColour, whiteColour);
-    }
-    myScreen.setFontSolid(false);
-    
-    //Manage "back" button
-    buttonOneState = digitalRead(buttonOne); //Read the state of ButtonOne (S1)
-    if(buttonOneState == LOW){  //If S1 is pressed, "back" text background turns yellow
-      myScreen.setFontSolid(true);
-      myScreen.gText(2, myScreen.screenSizeY()-10, "Back", blackColour, yellowColour);
-      myScreen.setFontSolid(false);
-      current_state = STATE_CMD_MENU;
-      return;
-    } 
-    //Manage "next" button
-    buttonTwoState = digitalRead(buttonTwo); //Read the state of ButtonTwo (S2)
-    if(buttonTwoState == LOW){  //If S2 is pressed, "next" text background turns yellow
-      myScreen.setFontSolid(true);
-      myScreen.gText(102, myScreen.screenSizeY()-10, "Next", blackColour, yellowColour);
-      myScreen.setFontSolid(false);
-      
-      if(cursor == 0){ carColor = redColour; }else if(cursor == 1){ carColor = blueColour; } else{ carColor = orangeColour; } //Set car colour based on cursor (selected option)
-      
-      current_state = STATE_SEL_DIFF;
-      return;
-    }
-  }
+  if(menuRun(&carPage, applySetting) == BUTTON_S2){ current_state = STATE_SEL_DIFF; }
+  else{ current_state = STATE_CMD_MENU; }
 }
 
 void fn_STATE_SEL_DIFF(){
-  //Print titles and buttons
-  myScreen.clear(whiteColour);
-  myScreen.gText(15,15, "SETTINGS", redColour, whiteColour, 2, 2);
-  myScreen.gText(1,45, "Select difficulty:", blackColour, yellowColour);
-  myScreen.gText(2, myScreen.screenSizeY()-10, "Back", blackColour);
-  myScreen.gText(102, myScreen.screenSizeY()-10, "Next", blackColour);
-
-  cursor = 0;
-  while(1){    
-    //Select option with analog
-    if(map(analogRead(joystickY), 0, 4096, 0, 100) < 20){
-      if(cursor < N_diff-1){ cursor++; }
-      else{ cursor = N_diff; }
-    }
-    else if(map(analogRead(joystickY), 0, 4096, 0, 100) > 80){
-      if(cursor>0){ cursor--; }
-      else{ cursor = 0; }
-    }
-
-    //Highlight selected option
-    myScreen.setFontSolid(true);
-    if(cursor == 0){
-      myScreen.gText(5,60+15*0, difficultyOptions[0], blackColour, yellowColour);        
-      myScreen.gText(5,60+15*1, difficultyOptions[1], blackColour, whiteColour);
-      myScreen.gText(5,60+15*2, difficultyOptions[2], blackColour, whiteColour);
-    }
-    else if(cursor == 1){
-      myScreen.gText(5,60+15*1, difficultyOptions[1], blackColour, yellowColour);
-      myScreen.gText(5,60+15*0, difficultyOptions[0], blackColour, whiteColour);
-      myScreen.gText(5,60+15*2, difficultyOptions[2], blackColour, whiteColour);
-    }
-    else{
-      myScreen.gText(5,60+15*2, difficultyOptions[2], blackColour, yellowColour);
-      myScreen.gText(5,60+15*1, difficultyOptions[1], blackColour, whiteColour);
-      myScreen.gText(5,60+15*0, difficultyOptions[0], blackColour, whiteColour);
-    }
-    myScreen.setFontSolid(false);
-    
-    //Manage "back" button
-    buttonOneState = digitalRead(buttonOne); //Read the state of ButtonOne (S1)
-    if(buttonOneState == LOW){  //If S1 is pressed, "back" text background turns yellow
-      myScreen.setFontSolid(true);
-      myScreen.gText(2, myScreen.screenSizeY()-10, "Back", blackColour, yellowColour);
-      myScreen.setFontSolid(false);
-      current_state = STATE_SEL_CAR;
-      return;
-    } 
-    //Manage "next" button
-    buttonTwoState = digitalRead(buttonTwo); //Read the state of ButtonTwo (S2)
-    if(buttonTwoState == LOW){  //If S2 is pressed, "next" text background turns yellow
-      myScreen.setFontSolid(true);
-      myScreen.gText(102, myScreen.screenSizeY()-10, "Next", blackColour, yellowColour);
-      myScreen.setFontSolid(false);
-      
-      switch(cursor){ //Set difficulty based on cursor (selected option)
-        case 0:
-          vel00 = 1;
-          waitTime = 40;
-          upperRandom = 30;
-          collectPoints = 5;
-          blocksNumber = 5;
-          break;
-        case 1:
-          vel00 = 2;
-          waitTime = 35;
-          upperRandom = 30;
-          collectPoints = 6;
-          blocksNumber = 7;
-          break;
-        case 2:
-          vel00 = 3;
-          waitTime = 35;
-          upperRandom = 40;
-          collectPoints = 5;
-          blocksNumber = 7;
-          break;
-      }
-      current_state = STATE_SEL_MODE;
-      return;
-    }
-  }
+  if(menuRun(&difficultyPage, applySetting) == BUTTON_S2){ current_state = STATE_SEL_MODE; }
+  else{ current_state = STATE_SEL_CAR; }
 }
 
 void fn_STATE_SEL_MODE(){
-  //Print titles and buttons
-  myScreen.clear(whiteColour);
-  myScreen.gText(15,15, "SETTINGS", redColour, whiteColour, 2, 2);
-  myScreen.gText(2,45, "Select drive mode:", blackColour, yellowColour);
-  myScreen.gText(2, myScreen.screenSizeY()-10, "Back", blackColour);
-  myScreen.gText(102, myScreen.screenSizeY()-10, "Next", blackColour);
-
-  cursor = 0;
-  while(1){    
-    //Select option with analog
-    if(map(analogRead(joystickY), 0, 4096, 0, 100) < 20){
-      if(cursor < N_modes-1){ cursor++; }
-      else{ cursor = N_modes; }
-    }
-    else if(map(analogRead(joystickY), 0, 4096, 0, 100) > 80){
-      if(cursor>0){ cursor--; }
-      else{ cursor = 0; }
-    }
-
-    //Highlight selected option
-    myScreen.setFontSolid(true);
-    if(cursor == 0){
-      myScreen.gText(5,60+15*0, modeOptions[0], blackColour, yellowColour);        
-      myScreen.gText(5,60+15*1, modeOptions[1], blackColour, whiteColour);
-    }
-    else if(cursor == 1){
-      myScreen.gText(5,60+15*1, modeOptions[1], blackColour, yellowColour);
-      myScreen.gText(5,60+15*0, modeOptions[0], blackColour, whiteColour);
-    }
-    myScreen.setFontSolid(false);
-    
-    //Manage "back" button
-    buttonOneState = digitalRead(buttonOne); //Read the state of ButtonOne (S1)
-    if(buttonOneState == LOW){  //If S1 is pressed, "back" text background turns yellow
-      myScreen.setFontSolid(true);
-      myScreen.gText(2, myScreen.screenSizeY()-10, "Back", blackColour, yellowColour);
-      myScreen.setFontSolid(false);
-      current_state = STATE_SEL_DIFF;
-      return;
-    } 
-    //Manage "next" button
-    buttonTwoState = digitalRead(buttonTwo); //Read the state of ButtonTwo (S2)
-    if(buttonTwoState == LOW){  //If S2 is pressed, "next" text background turns yellow
-      myScreen.setFontSolid(true);
-      myScreen.gText(102, myScreen.screenSizeY()-10, "Next", blackColour, yellowColour);
-      myScreen.setFontSolid(false);
-      
-      if(cursor == 0){ driveMode = true; } else{ driveMode = false; } //Set drive mode based on cursor (selected option)
-      
-      current_state = STATE_CMD_GAME;
-      return;
-    }
-  }
+  if(menuRun(&modePage, applySetting) == BUTTON_S2){ current_state = STATE_CMD_GAME; }
+  else{ current_state = STATE_SEL_DIFF; }
 }
 
 void fn_STATE_CMD_GAME(){
+  adcSetPeriod(0);
+
   //Print how to navigate settings
   myScreen.clear(whiteColour);
-  myScreen.setFontSolid(false);
-  myScreen.gText(10,15, "Game Cmds", redColour, whiteColour, 2, 2);
-  myScreen.gText(7,45, "Avoid the obstacles", blackColour);
-  myScreen.gText(15,55, "and earn as many", blackColour);
-  myScreen.gText(10,65, "points as you can!", blackColour);
-  myScreen.gText(1,85, "S1: switch drive mode", blackColour);
-  myScreen.gText(1,95, "S2: restart race", blackColour);
+  textFontSolid(false);
+  textDraw(10,15, "Game Cmds", redColour, whiteColour, 2, 2);
+  textDraw(7,45, "Avoid the obstacles", blackColour);
+  textDraw(15,55, "and earn as many", blackColour);
+  textDraw(10,65, "points as you can!", blackColour);
+  textDraw(1,85, "S1: switch drive mode", blackColour);
+  textDraw(1,95, "S2: restart race", blackColour);
   
   //Print "Back" and "PLAY" buttons
-  myScreen.gText(2, myScreen.screenSizeY()-10, "Back", blackColour);
-  myScreen.gText((myScreen.screenSizeX()/2)+13,myScreen.screenSizeY()-10, "PLAY", blackColour, yellowColour, 2);
+  textDraw(2, myScreen.screenSizeY()-10, "Back", blackColour);
+  textDraw((myScreen.screenSizeX()/2)+13,myScreen.screenSizeY()-10, "PLAY", blackColour, yellowColour, 2);
 
-  cursor = 0;
   while(1){
     //Manage "back" button
-    buttonOneState = digitalRead(buttonOne); //Read the state of ButtonOne (S1)
-    if(buttonOneState == LOW){  //If S1 is pressed, "back" text background turns yellow
-      myScreen.setFontSolid(true);
-      myScreen.gText(3,myScreen.screenSizeY()-10, "Back", blackColour, yellowColour);
-      myScreen.setFontSolid(false);
+    checkButtons(); //Sleep until S1 or S2 is pressed
+    if(triggeredButton == BUTTON_S1){  //If S1 is pressed, "back" text background turns yellow
+      textFontSolid(true);
+      textDraw(3,myScreen.screenSizeY()-10, "Back", blackColour, yellowColour);
+      textFontSolid(false);
       current_state = STATE_SEL_MODE;
       return;
     } 
     //Manage "PLAY" button
-    buttonTwoState = digitalRead(buttonTwo); //Read the state of ButtonTwo (S2)
-    if(buttonTwoState == LOW){  //If S2 is pressed, "next" text background turns yellow
-      myScreen.setFontSolid(true);
-      myScreen.gText((myScreen.screenSizeX()/2)+13,myScreen.screenSizeY()-10, "PLAY", blackColour, redColour, 2);
-      myScreen.setFontSolid(false);      
+    if(triggeredButton == BUTTON_S2){  //If S2 is pressed, "next" text background turns yellow
+      textFontSolid(true);
+      textDraw((myScreen.screenSizeX()/2)+13,myScreen.screenSizeY()-10, "PLAY", blackColour, redColour, 2);
+      textFontSolid(false);      
       current_state = STATE_INIT_GAME;
       return;
     }
   }
 }
 
+/** Scene functions
+ * 
+ * 1. damageBlock --> mark old and new position of block i as damaged if it moved since it was drawn
+ * 2. roadPlace --> give block i the fraction of row of the road, so that it falls row by row with the road scroll
+ * 3. spawnBlock --> take a block from the pool at the top of the road, falling at the current velocity
+ * 4. speedStep --> one step of the speed curve: ease towards the level speed and give the new velocity to every block
+ * 5. carBox --> bounding box of the car sprite when the car body is at (cx, cy)
+ * 6. trackLayerRow --> kerbs and dashed centre line of one row, in road coordinates (row - roadRows)
+ * 7. addScene --> describe the whole playfield to the compositor in draw order: grass, track, blocks, car, score on top
+ * 8. drawRoad --> scroll the road by the rows travelled and damage the blocks that moved on screen
+ * 9. drawCar --> damage the old and new place of the car if it moved
+ * 10. drawFlush --> render the damage over the scene and queue or push it; a frame can flush twice, the car last
+ * 11. roadBegin --> make the road the scroll area and draw its first frame, over the background
+ * 12. roadEnd --> wait for the queued frames and leave the scrolled screen as plain screen rows for the pages drawing after the game
+ * 
+ */
+void damageBlock(uint16_t i){
+  if((blockX[i] == blockDrawnX[i]) && (blockY[i] == blockDrawnY[i])){ return; }
+  compositorDamage(blockDrawnX[i], blockDrawnY[i], blockDim, blockDim); //Old position
+  compositorDamage(blockX[i], blockY[i], blockDim, blockDim); //New position
+  blockDrawnX[i] = blockX[i];
+  blockDrawnY[i] = blockY[i];
+}
+
+void roadPlace(uint16_t i){
+  if(i != BLOCK_NONE){ blockFallY[i] = Q16(blockY[i]) + (roadFall & (Q16_ONE-1)); }
+}
+
+void spawnBlock(){
+  roadPlace(blockAlloc(random(grassWidth, (myScreen.screenSizeX()-grassWidth - blockDim)), 0, stepVel, colors[blockSpawns % 10]));
+  blockSpawns++;
+}
+
+void speedStep(){
+  if(speed == speedTarget){ return; }
+  q16_t diff = speedTarget - speed;
+  if((diff >> SPEED_EASE_SHIFT) == 0 || (diff >> SPEED_EASE_SHIFT) == -1){ speed = speedTarget; } //Last fraction of the way
+  else{ speed += diff >> SPEED_EASE_SHIFT; }
+  stepVel = q16Mul(speed, STEP_PER_TICK);
+  for(uint16_t k = 0; k < blockCount; k++){ blockVel[blockActive[k]] = stepVel; }
+}
+
+CompRect_t carBox(uint8_t cx, uint8_t cy){
+  CompRect_t r = {(int16_t)(cx-tyreDim), (int16_t)cy, CAR_SPRITE_W, CAR_SPRITE_H};
+  return r;
+}
+
+void trackPaint(int16_t a, int16_t b, uint16_t colour, int16_t x1, int16_t w, uint16_t *out){
+  a = max(a, x1);
+  b = min(b, (int16_t)(x1+w));
+  for(int16_t x = a; x < b; x++){ out[x-x1] = colour; }
+}
+
+void trackLayerRow(int16_t row, int16_t x1, int16_t w, uint16_t *out){
+  if(row < ROAD_TOP){ return; } //The score rows do not scroll
+  bool first = ((uint16_t)(row - roadRows) % ROAD_PERIOD) < ROAD_PERIOD/2;
+  uint16_t kerb = first ? redColour : whiteColour;
+  int16_t right = myScreen.screenSizeX()-grassWidth;
+  trackPaint(grassWidth-KERB_WIDTH, grassWidth, kerb, x1, w, out);
+  trackPaint(right, right+KERB_WIDTH, kerb, x1, w, out);
+  if(first){ trackPaint(myScreen.screenSizeX()/2-1, myScreen.screenSizeX()/2+1, whiteColour, x1, w, out); }
+}
+
+void addScene(){
+  compositorObject(0, 0, grassWidth, myScreen.screenSizeY(), greenColour); //Left grass (road is the black default)
+  compositorObject(myScreen.screenSizeX()-grassWidth, 0, grassWidth, myScreen.screenSizeY(), greenColour); //Right grass
+#if ROAD_SCROLL
+  compositorLayer(trackLayerRow); //Kerbs and centre line
+#endif
+  compositorLayer(blockLayerRow); //Blocks, found through the pool grid row by row
+  compositorSprite(x00-tyreDim, y00, &carSprites[carSprite], carColor); //Car, body in the chosen colour
+  compositorText(scoreHud.x, scoreHud.y, scoreHud.text, redColour); //Score
+}
+
+void drawRoad(){
+  int16_t dy = q16Floor(roadFall); //Whole rows travelled by the road, and by every block, since the last frame
+  roadFall -= Q16(dy);
+  roadRows += dy;
+#if ROAD_SCROLL
+  compositorScroll(dy);
+  for(uint16_t k = 0; k < blockCount; k++){ //Blocks were carried down with the road
+    uint16_t i = blockActive[k];
+    if(blockDrawnY[i] < ROAD_TOP){ compositorDamage(blockDrawnX[i], blockDrawnY[i], blockDim, blockDim+dy); } //Partly in the fixed rows
+    blockDrawnY[i] += dy;
+  }
+  carDrawn.h += dy; //The car image was carried down too, its old place is redrawn with the new one
+#endif
+  for(uint16_t k = 0; k < blockCount; k++){ damageBlock(blockActive[k]); }
+}
+
+void drawCar(){
+  CompRect_t car = carBox(x00, y00);
+  if((car.x != carDrawn.x) || (car.y != carDrawn.y) || (car.h != carDrawn.h)){
+    compositorDamageMove(carDrawn, car); //Old and new position, in one window when they overlap
+    carDrawn = car;
+  }
+}
+
+void drawFlush(){
+  addScene();
+#if RENDER_MODE == RENDER_BANDS
+  bandFlush(false);
+#else
+  compositorFlush();
+#endif
+}
+
+void roadBegin(){
+  carDrawn = carBox(x00, y00);
+#if ROAD_SCROLL
+  compositorScrollArea(ROAD_TOP, myScreen.screenSizeY()-ROAD_TOP);
+  compositorBegin();
+  addScene();
+  compositorDamage(0, ROAD_TOP, myScreen.screenSizeX(), myScreen.screenSizeY()-ROAD_TOP); //Kerbs and lines of the first frame
+  compositorFlush();
+#endif
+}
+
+void roadEnd(){
+  displayAsync(false);
+  latencyPoll(); //Frames still in the queue
+#if ROAD_SCROLL
+  compositorBegin();
+  addScene();
+  compositorScrollEnd();
+#endif
+}
+
+/** Game step policies
+ * 
+ * The game step is a template over a difficulty and an input source, so the presets and the drive mode are constants
+ * inside it: no setting is read from memory or tested in the frame loop.
+ * 1. PresetDifficulty<d> --> the values of difficultyProfiles[d]
+ * 2. CustomDifficulty --> generic fallback: the settings globals, for anything that is not a preset (tuner, old sessions)
+ * 3. JoystickInput, AccelerometerInput --> samples to car position, the ranges of map() as constants, and the first of
+ *    the two ADC channels the late latch converts
+ * 
+ */
+template<uint8_t D> struct PresetDifficulty{
+  static constexpr uint8_t vel00(){ return difficultyProfiles[D].vel00; }
+  static constexpr uint32_t spawnUs(){ return (uint32_t)difficultyProfiles[D].waitTime*GAME_TICK_US; }
+  static constexpr uint8_t upperRandom(){ return difficultyProfiles[D].upperRandom; }
+  static constexpr uint8_t collectPoints(){ return difficultyProfiles[D].collectPoints; }
+  static constexpr uint8_t blocksNumber(){ return difficultyProfiles[D].blocksNumber; }
+  static constexpr uint16_t speedGain(){ return difficultyProfiles[D].speedGain; }
+};
+
+struct CustomDifficulty{
+  static uint8_t vel00(){ return ::vel00; }
+  static uint32_t spawnUs(){ return (uint32_t)waitTime*GAME_TICK_US; }
+  static uint8_t upperRandom(){ return ::upperRandom; }
+  static uint8_t collectPoints(){ return ::collectPoints; }
+  static uint8_t blocksNumber(){ return ::blocksNumber; }
+  static uint16_t speedGain(){ return ::speedGain; }
+};
+
+template<long inMin, long inMax, long outMin, long outMax> long mapConst(long v){ //map() with constant ranges
+  return (v - inMin)*(outMax - outMin)/(inMax - inMin) + outMin;
+}
+
+struct JoystickInput{
+  static const uint8_t channel = ADC_JOY_X;
+  static void car(const AdcFrame_t *in){
+    x = mapConst<0, 4096, 0, 128>(in->value[ADC_JOY_X]);
+    y = mapConst<0, 4096, 128, 0>(in->value[ADC_JOY_Y])+offset;
+  }
+};
+
+struct AccelerometerInput{
+  static const uint8_t channel = ADC_ACC_X;
+  static void car(const AdcFrame_t *in){
+    x = mapConst<1250, 2850, 0, 128>(in->value[ADC_ACC_X]);
+    y = mapConst<2850, 1250, 0, 128>(in->value[ADC_ACC_Y]);
+  }
+};
+
+/** Game step functions
+ * 
+ * 1. gameCar --> car motion from the samples of input
+ * 2. gameStep --> car motion, unless input is NULL (late latch: the car moves after the blocks are drawn), then the
+ *    simulation steps due in this frame: spawning, motion, score and collision against the car as it is on screen.
+ *    Sets collision
+ * 
+ */
+template<class Input> void gameCar(const AdcFrame_t *input){
+  //---------------------------------------------------------------CAR MOTION---------------------------------------------------------------
+  PROF_PHASE(PHASE_CAR);
+  Input::car(input); //Map the samples of the drive mode
+
+  //Borders delimination
+  if(x < grassWidth+tyreDim){ x = grassWidth+tyreDim; }
+  if(x > myScreen.screenSizeX()-(grassWidth+carWidth+tyreDim)){ x = myScreen.screenSizeX()-(grassWidth+carWidth+tyreDim); }
+  if(y > myScreen.screenSizeY()-carLength){ y =  myScreen.screenSizeY()-carLength; }
+  
+  //Move car
+  if ((x00 != x) && (y00 != y) && !collision) { //Draws only if position changes
+    x00 = x;
+    y00 = y;
+  }
+}
+
+template<class Difficulty, class Input> void gameStep(uint8_t steps, const AdcFrame_t *input){
+  if(input != NULL){ gameCar<Input>(input); }
+  
+  for(uint8_t s = 0; s < steps && !collision; s++){
+    //------------------------------------------BLOCKS SPAWNING----------------------------------------------------------------------------------------------
+    PROF_PHASE(PHASE_SPAWN);
+    if(blockCount<Difficulty::blocksNumber() && (timer < FRAME_PERIOD_US)){ //Every n=waitTime ticks...
+      if(random(100) > Difficulty::upperRandom()){ //...possibility of a block to spawn 
+        spawnBlock();
+      }
+    }
+    timer += FRAME_PERIOD_US;
+    if(timer >= Difficulty::spawnUs()){ timer -= Difficulty::spawnUs(); } //The overshoot is kept: no drift from the period
+
+    //-------------------------------------------------------------BLOCKS MOTION--------------------------------------------------------------
+    PROF_PHASE(PHASE_MOTION);
+    speedStep();
+    roadFall += stepVel; //The road moves with the blocks
+    for(uint16_t k = 0; k < blockCount; k++){
+      uint16_t i = blockActive[k];
+      if(!blockFall(i, myScreen.screenSizeY())){ //If block reaces bottom of the screen...
+        if(blockSwept(i, x00 - tyreDim, y00, x00+tyreDim+carWidth, y00+carLength)){ collision = true; continue; } //Its last step crossed the car
+        score ++; //Update score
+        tmp_score++;
+        blockMove(i, random(grassWidth, (myScreen.screenSizeX()-grassWidth - blockDim)), 0);
+        roadPlace(i);
+      }
+
+      if(tmp_score == (Difficulty::collectPoints()+vel)){ //Every n=collectPoints points earned, raise the level speed (reached smoothly by speedStep) and blink redLED
+        vel++; tmp_score=0; digitalWrite(redLED, HIGH); ledOn = true; ledOffTime = millis()+100;
+        speedTarget = Q16(Difficulty::vel00()) + (q16_t)(vel - Difficulty::vel00())*Difficulty::speedGain()*(Q16_ONE/256);
+      }
+    }
+
+    //---------------------------------------------------COLLISION----------------------------------------------------
+    PROF_PHASE(PHASE_COLLISION);
+    //Only the blocks in the grid cells around the car are tested, along the whole path of their last step
+    if(blockSweep(x00 - tyreDim, y00, x00+tyreDim+carWidth, y00+carLength, q16Ceil(stepVel), blockHits, 1) > 0){
+      collision = true;
+    }
+  }
+}
+
+/** Game step selection
+ * 
+ * 1. gameSteps --> every instantiation: one row per preset then the generic one, one column per drive mode
+ * 2. gameInputs --> car motion and late latch channel of every drive mode
+ * 3. gameSelect --> the instantiations of the current settings: a preset only if every value matches it
+ * 
+ */
+typedef void (*GameStep_t)(uint8_t steps, const AdcFrame_t *input);
+
+typedef struct{
+  void (*car)(const AdcFrame_t *input);
+  uint8_t channel; //First of the two channels of the drive mode
+}GameInput_t;
+
+const GameStep_t gameSteps[N_diff+1][N_modes] = {
+  {gameStep<PresetDifficulty<0>, JoystickInput>, gameStep<PresetDifficulty<0>, AccelerometerInput>},
+  {gameStep<PresetDifficulty<1>, JoystickInput>, gameStep<PresetDifficulty<1>, AccelerometerInput>},
+  {gameStep<PresetDifficulty<2>, JoystickInput>, gameStep<PresetDifficulty<2>, AccelerometerInput>},
+  {gameStep<CustomDifficulty, JoystickInput>, gameStep<CustomDifficulty, AccelerometerInput>}
+};
+static_assert(N_diff == 3, "one row of gameSteps per difficulty preset");
+const GameInput_t gameInputs[N_modes] = {
+  {gameCar<JoystickInput>, JoystickInput::channel},
+  {gameCar<AccelerometerInput>, AccelerometerInput::channel}
+};
+GameStep_t gameStepFn = gameSteps[N_diff][0]; //Chosen by fn_STATE_INIT_GAME
+const GameInput_t *gameInput = &gameInputs[0];
+
+void gameSelect(){
+  uint8_t d = N_diff;
+  for(uint8_t k = 0; k < N_diff; k++){
+    const DifficultyProfile_t *p = &difficultyProfiles[k];
+    if((vel00 == p->vel00) && (waitTime == p->waitTime) && (upperRandom == p->upperRandom) && (collectPoints == p->collectPoints) &&
+       (blocksNumber == p->blocksNumber) && (speedGain == p->speedGain)){ d = k; break; }
+  }
+  gameStepFn = gameSteps[d][driveMode ? 0 : 1];
+  gameInput = &gameInputs[driveMode ? 0 : 1];
+}
+
 void fn_STATE_INIT_GAME(){
   pinMode(redLED, OUTPUT); //Set redLED as OUTPUT
   x00 = grassWidth+tyreDim; //Setup car zero-position
+  y00 = myScreen.screenSizeY()-offset; //Nothing from the previous game may change this one
 
-  //Initialise blocks spawning positions
-  for(int i = 0; i < blocksNumber; i++){
-    x_block[i]=random(16, 103);
-    y_block[i]=0;
-  }
+  //Empty the blocks pool
+  blockPoolReset();
+  blockSpawns = 0;
 
   //Reset game variables
+  profReset(); //The profile and latency dumped at game over cover this game only
+  latencyReset();
   score = 0;  
   tmp_score = 0;
   timer = 0;
-  vel = vel00;
-  current_n_blocks = 0;
+  ledOn = false;
+  digitalWrite(redLED, LOW);
   collision = false;
+  roadFall = 0;
+  roadRows = 0;
+  textHudReset(&scoreHud, 1, 2); //Drawn whole on the first frame, over the new background
+
+  //Seed the RNG and record the settings, or take both from the replayed session
+  SessionHeader_t header = {micros() ^ (uint32_t)random(0x7FFFFFFF), (uint16_t)carColor, carSprite, speedGain, vel00, waitTime, upperRandom, collectPoints, blocksNumber, driveMode, lateLatch};
+  if(!sessionOpen(&header)){ session.mode = SESSION_MODE; sessionOpen(&header); } //Unreadable stream: play normally
+  carColor = header.carColour; carSprite = header.carSprite % CAR_SPRITES; vel00 = header.vel00; waitTime = header.waitTime; upperRandom = header.upperRandom;
+  collectPoints = header.collectPoints; blocksNumber = header.blocksNumber; driveMode = header.driveMode; speedGain = header.speedGain;
+  lateLatch = header.lateLatch;
+  randomSeed(header.seed);
+  vel = vel00;
+  speed = speedTarget = Q16(vel00);
+  stepVel = q16Mul(speed, STEP_PER_TICK);
+  gameSelect(); //Once per game: the frame loop never looks at the settings
 
   //Launch countdown
-  countDown();
+  if(sessionRealTime()){ countDown(); }
 
   //Setup background
   myScreen.setPenSolid(true);
   myScreen.dRectangle(0, 0, grassWidth, myScreen.screenSizeY(), greenColour);
   myScreen.dRectangle(myScreen.screenSizeX()-grassWidth, 0, grassWidth, myScreen.screenSizeY(), greenColour);
+  roadBegin();
+  displayAsync(DISPLAY_ASYNC);
   
+  buttonFlush(); //Ignore presses made during the countdown
+  adcSetPeriod(ADC_PERIOD_MS);
+  frameSchedulerStart(&gameFrames);
   current_state = STATE_GAME;
 }
 
 void fn_STATE_GAME(){
  
   while(1){
-    //Manage buttons
-    buttonOneState = digitalRead(buttonOne);
-    buttonTwoState = digitalRead(buttonTwo);
+    PROF_PHASE(PHASE_INPUT);
+    uint8_t steps = frameSchedulerSteps(&gameFrames); //Fixed simulation steps due in this frame
+    compositorBegin();
 
-    if(buttonOneState == LOW){ if(driveMode==true){ driveMode = false; } else{ driveMode = true; }} //ButtonOne (S1) = Switch between drive modes
-    if(buttonTwoState == LOW){ current_state = STATE_INIT_GAME; break;} //ButtonTwo (S2) = Reset the game
-    
-    //---------------------------------------------------------------CAR MOTION---------------------------------------------------------------
-    //Map analogRead based on drive mode
-    if(driveMode == 1){ x = map(analogRead(joystickX), 0, 4096, 0, 128); y = map(analogRead(joystickY), 0, 4096, 128, 0)+offset; }
-    else{ x = map(analogRead(xpin), 1250, 2850, 0, 128); y = map(analogRead(ypin), 2850, 1250, 0, 128); }
-
-    //Borders delimination
-    if(x < grassWidth+tyreDim){ x = grassWidth+tyreDim; }
-    if(x > myScreen.screenSizeX()-(grassWidth+carWidth+tyreDim)){ x = myScreen.screenSizeX()-(grassWidth+carWidth+tyreDim); }
-    if(y > myScreen.screenSizeY()-carLength){ y =  myScreen.screenSizeY()-carLength; }
-    
-    //Draw car
-    if ((x00 != x) && (y00 != y) && !collision) { //Draws only if position changes
-      myScreen.dRectangle(x00, y00, carWidth, carLength, blackColour); //Delete car body
-      myScreen.dRectangle(x00-tyreDim, y00, tyreDim, tyreDim, blackColour); //Delete left front wheel
-      myScreen.dRectangle(x00-tyreDim, y00+carLength-tyreDim, tyreDim, tyreDim, blackColour); //Delete left back wheel
-      myScreen.dRectangle(x00+carWidth, y00, tyreDim, tyreDim, blackColour); //Delete right front wheel
-      myScreen.dRectangle(x00+carWidth, y00+carLength-tyreDim, tyreDim, tyreDim, blackColour); //Delete right back wheel
-      
-      myScreen.dRectangle(x, y, carWidth, carLength, carColor); //Draw car body
-      myScreen.dRectangle(x-tyreDim, y, tyreDim, tyreDim, greyColour); //Draw left front wheel
-      myScreen.dRectangle(x-tyreDim, y+carLength-tyreDim, tyreDim, tyreDim, greyColour); //Draw left back wheel
-      myScreen.dRectangle(x+carWidth, y, tyreDim, tyreDim, greyColour); //Draw right front wheel
-      myScreen.dRectangle(x+carWidth, y+carLength-tyreDim, tyreDim, tyreDim, greyColour); //Draw right back wheel
-      
-      x00 = x;
-      y00 = y;
-    }
-    
-    //------------------------------------------BLOCKS SPAWNING----------------------------------------------------------------------------------------------
-    uint8_t r = timer % waitTime;
-    
-    if(current_n_blocks<blocksNumber && (r == 0)){ //Every n=waitTime cycles...
-      if(random(100) > upperRandom){ //...possibility of a block to spawn 
-        current_n_blocks++;
-        timer=0;
-      }
-    }
-    timer++;
-
-    //-------------------------------------------------------------BLOCKS MOTION--------------------------------------------------------------
-     
-    for(int i = 0; i < current_n_blocks; i++){
+    //Inputs of this frame: one button event per press and the latest filtered samples, recorded or replayed
+    triggeredButton = buttonPressed();
+    AdcFrame_t input = adcLatest();
+    if(!sessionEvents(&steps, &triggeredButton)){ sessionClose(score, session.frames); roadEnd(); current_state = STATE_GAME_OVER; PROF_END(); return; } //Replay over
 
-      if (!collision) {
-        y_block[i] = y_block[i] + vel;
-        myScreen.dRectangle(x_block[i], y_block[i]-vel, blockDim, vel, blackColour); //Erase previous block (old position)
-        myScreen.dRectangle(x_block[i], y_block[i], blockDim, blockDim, colors[i]);  //Draws block (new position)
-      }
-      if(y_block[i] >= myScreen.screenSizeY()){ //If block reaces bottom of the screen...
-        score ++; //Update score
-        tmp_score++;
-        y_block[i]=0;
-        x_block[i]=random(grassWidth, (myScreen.screenSizeX()-grassWidth - blockDim));
-      }
-
-      if(tmp_score == (collectPoints+vel)){ vel++; tmp_score=0; digitalWrite(redLED, HIGH); delay(100); digitalWrite(redLED, LOW); } //Every n=collectPoints points earned, increase block's falling velocity and blink redLED
-
-      //---------------------------------------------------COLLISION----------------------------------------------------
-      if(((y_block[i]+blockDim) >= y00) && (y_block[i]  <= (y00+carLength))){ //Y-Axis collision check
-        if(((x_block[i]+blockDim) >= (x00 - tyreDim)) && (x_block[i] <= (x00+tyreDim+carWidth))){ //X-Axis collision check
-          //If collision occurred, go to game over state
-          collision = true;
-          current_state = STATE_GAME_OVER;
-          return;
-        }
-      }
+    //Manage buttons
+    if(triggeredButton == BUTTON_S1){ driveMode = !driveMode; gameSelect(); } //ButtonOne (S1) = Switch between drive modes
+    if(triggeredButton == BUTTON_S2){ sessionInput(&input); sessionClose(score, session.frames); roadEnd(); current_state = STATE_INIT_GAME; PROF_END(); break;} //ButtonTwo (S2) = Reset the game
+    
+    if(lateLatch){ gameStepFn(steps, NULL); } //Spawning, motion and collision, specialized for the settings; the car moves last
+    else{ sessionInput(&input); gameStepFn(steps, &input); } //Car first, from the sample of the start of the frame
+
+    PROF_PHASE(PHASE_HUD);
+    if(!collision){ textHudNumber(&scoreHud, score); } //Score: only the digits that changed are redrawn
+
+    //Draw the frame: the road scrolls, damaged regions are merged and each one is pushed with a single window
+    PROF_PHASE(PHASE_DRAW);
+    drawRoad();
+    if(lateLatch){ //Everything but the car, then the steering sampled now and the car alone: the last and smallest window
+      drawFlush();
+      input = adcLatch(gameInput->channel, 2);
+      sessionInput(&input);
+      gameInput->car(&input);
+      PROF_PHASE(PHASE_DRAW);
+      compositorBegin();
     }
+    drawCar();
+    drawFlush();
+    latencyFrame(input.stamp_us, displaySubmit()); //Sent while the next frame is computed; waits only if the previous one is still going out
+    if(collision){ sessionClose(score, session.frames); roadEnd(); digitalWrite(redLED, LOW); ledOn = false; current_state = STATE_GAME_OVER; PROF_END(); return; } //Go to game over state
 
-    //Print score
-    myScreen.dRectangle(0, 0, grassWidth, grassWidth, greenColour); 
-    myScreen.gText(1, 2, (String)score, redColour, greenColour);
+    //End the speed-up blink without stalling the frame
+    if(ledOn && ((int32_t)(millis()-ledOffTime) >= 0)){ digitalWrite(redLED, LOW); ledOn = false; }
         
-    delay(100);
+    PROF_PHASE(PHASE_WAIT);
+    if(sessionRealTime()){ frameSchedulerWait(&gameFrames); } //Sleep only for what is left of the frame budget
   }
 }
 
 void fn_STATE_GAME_OVER(){ 
+  adcSetPeriod(0);
+
   //Print GAME OVER 
-  myScreen.setFontSolid(true);
-  myScreen.gText(27, 30, "GAME", redColour, 3, 3); 
-  myScreen.gText(27, 45, "OVER", redColour, 3, 3);
-
-  //Print score and (new) record
-  if(score > record) record = score;
-  myScreen.gText(15, (myScreen.screenSizeY()/2+10), "Score:" + (String)score, redColour, 2, 2);
-  myScreen.gText(10, (myScreen.screenSizeY()/2+25), "Record:" + (String)record, redColour, 2, 2);
-  myScreen.setFontSolid(false);
-
-  //Wait for buttons to be triggered...
-  checkButtons();
-  if(triggeredButton == 1){ current_state = STATE_SEL_CAR; return; }
-  if(triggeredButton == 2){ current_state = STATE_INIT_GAME; return; }
+  textFontSolid(true);
+  textDraw(27, 30, "GAME", redColour, 3, 3); 
+  textDraw(27, 45, "OVER", redColour, 3, 3);
+
+  //Print score and (new) record: saved to flash by the idle loops, never here
+  scoreStoreSubmit(scoreKey(), score);
+  record = scoreStoreBest(scoreKey());
+  char text[8+TEXT_HUD_CHARS]; //"Record:" and any uint32_t
+  formatLabel("Score:", score, text);
+  textDraw(15, (myScreen.screenSizeY()/2+10), text, redColour, 2, 2);
+  formatLabel("Record:", record, text);
+  textDraw(10, (myScreen.screenSizeY()/2+25), text, redColour, 2, 2);
+  if(session.replayed){ textDraw(27, myScreen.screenSizeY()-10, session.matched ? "Replay OK" : "Replay FAIL", redColour); }
+  textFontSolid(false);
+
+  //Wait for buttons: S1 released --> settings, S1 held --> replay the game just played, S2 --> play again
+  buttonFlush(); //Ignore presses made during the game
+#if PROF_GAME_OVER_DUMP
+  latencyDump(); //Input-to-display latency and profile of the game just played
+  profDump();
+#endif
+  bool oneDown = false;
+  while(1){
+    ButtonEvent_t e;
+    if(!buttonEvent(&e)){ idleWait(); continue; } //Let the CPU sleep until the next event
+    if((e.button == BUTTON_S2) && (e.type == BUTTON_PRESS)){ current_state = STATE_INIT_GAME; return; }
+    if(e.button != BUTTON_S1){ continue; }
+    if(e.type == BUTTON_PRESS){ oneDown = true; }
+    else if(oneDown && (e.type == BUTTON_RELEASE)){ current_state = STATE_SEL_CAR; return; }
+    else if(oneDown && (e.type == BUTTON_LONG) && (session.mode == SESSION_RECORD) && !session.truncated){
+      sessionReplay(sessionBuffer, session.size, false);
+      current_state = STATE_INIT_GAME;
+      return;
+    }
+  }
 }
@@ -0,0 +1,237 @@
+/**
+ * @file scoreStore.h
+ *
+ * @brief High scores saved in flash: append-only log over rotating sectors, checksummed records, writes spread over the idle loops
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/** Score Store
+ *
+ * One best score per key (car, difficulty and drive mode), kept in RAM and saved in the flash sectors of hal.h.
+ * 1. Sector --> header (magic, sequence number, CRC) in the first 8 bytes, then records of 8 bytes
+ *    (tag, key, score, CRC) appended in order; the sector with a valid header and the newest sequence number is the live one
+ * 2. scoreStoreBegin --> read the headers and the live sector up to its first erased slot: the boot scan is bounded by
+ *    one sector, whatever the age of the store. Records with a bad CRC (power lost mid-write) are skipped
+ * 3. scoreStoreSubmit --> only updates RAM and marks the key dirty: safe in the game loop, nothing touches the flash
+ * 4. scoreStoreIdle --> called by the loops waiting for the player (menus, buttons, game over): at most one flash
+ *    operation per call, so the wait is extended by one program (~0.1 ms) or one erase (~12 ms) at worst
+ * 5. Compaction --> when the live sector is full, the next one is erased, the bests are copied and its header is written
+ *    last: until then the old sector stays live, so a power loss at any point keeps the last saved scores.
+ *    Sectors are used in turn, which spreads the erases evenly
+ *
+ */
+#define STORE_KEYS 32 //One dirty bit each
+#define STORE_RECORD_BYTES 8
+#define STORE_SLOTS (FLASH_SECTOR_BYTES/STORE_RECORD_BYTES) //Slot 0 is the header
+#define STORE_MAGIC 0x5352 //"RS"
+#define STORE_TAG 0xA5
+
+typedef struct{
+  uint16_t magic;
+  uint16_t seq; //Incremented by every compaction, compared with serial arithmetic
+  uint16_t spare;
+  uint16_t crc; //Over the first 6 bytes
+}StoreHeader_t;
+
+typedef struct{
+  uint8_t tag;
+  uint8_t key;
+  uint16_t score;
+  uint16_t spare;
+  uint16_t crc; //Over the first 6 bytes
+}StoreRecord_t;
+
+typedef enum{
+  STORE_IDLE, //Dirty keys are appended to the live sector
+  STORE_ERASE, //Compaction: erase the target sector
+  STORE_COPY, //Compaction: one best per call
+  STORE_SEAL //Compaction: write the header of the target sector
+}StoreStep_t;
+
+typedef struct{
+  uint16_t best[STORE_KEYS];
+  uint32_t dirty; //Keys whose best is not in flash yet, one bit each
+  bool live; //A sector holds a valid header
+  uint8_t sector; //Live sector
+  uint16_t seq; //Its sequence number
+  uint16_t next; //First free slot of the live sector
+  uint8_t step; //StoreStep_t
+  uint8_t target; //Sector being compacted into
+  uint8_t copyKey; //Next key to copy
+  uint16_t copySlot; //Next slot of the target sector
+}ScoreStore_t;
+
+typedef struct{
+  uint32_t bootUs; //Duration of the last boot scan
+  uint16_t records; //Valid records read at boot
+  uint16_t badRecords; //Records skipped at boot
+  uint32_t appends; //Records written
+  uint32_t compactions;
+  uint32_t failures; //Programs that did not verify
+}ScoreStoreStats_t;
+
+static_assert(sizeof(StoreRecord_t) == STORE_RECORD_BYTES, "records must fill their slot");
+static_assert(sizeof(StoreHeader_t) == STORE_RECORD_BYTES, "the header must fill slot 0");
+
+ScoreStore_t scoreStore;
+ScoreStoreStats_t storeStats;
+
+/** CRC function
+ *
+ * CRC-16/CCITT of n bytes
+ *
+ */
+uint16_t storeCrc(const void *data, uint8_t n){
+  const uint8_t *p = (const uint8_t *)data;
+  uint16_t crc = 0xFFFF;
+  while(n-- > 0){
+    crc ^= (uint16_t)(*p++) << 8;
+    for(uint8_t b = 0; b < 8; b++){ crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1); }
+  }
+  return crc;
+}
+
+/** Slot functions
+ *
+ * 1. storeErased --> true if the 8 bytes read are all 0xFF
+ * 2. storeHeaderValid, storeRecordValid --> magic or tag, range and CRC
+ * 3. storeNewer --> true if sequence a comes after b (wraps around)
+ *
+ */
+bool storeErased(const void *slot){
+  const uint8_t *p = (const uint8_t *)slot;
+  for(uint8_t i = 0; i < STORE_RECORD_BYTES; i++){ if(p[i] != 0xFF){ return false; } }
+  return true;
+}
+
+bool storeHeaderValid(const StoreHeader_t *h){
+  return (h->magic == STORE_MAGIC) && (h->crc == storeCrc(h, 6));
+}
+
+bool storeRecordValid(const StoreRecord_t *r){
+  return (r->tag == STORE_TAG) && (r->key < STORE_KEYS) && (r->crc == storeCrc(r, 6));
+}
+
+bool storeNewer(uint16_t a, uint16_t b){
+  return (int16_t)(a - b) > 0;
+}
+
+/** Boot function
+ *
+ * Find the live sector and load the bests it holds
+ *
+ */
+void scoreStoreBegin(){
+  uint32_t start = micros();
+  memset(&scoreStore, 0, sizeof(scoreStore));
+  storeStats.records = 0;
+  storeStats.badRecords = 0;
+  for(uint8_t s = 0; s < FLASH_STORE_SECTORS; s++){
+    StoreHeader_t h;
+    flashRead(s, 0, &h, sizeof(h));
+    if(storeHeaderValid(&h) && (!scoreStore.live || storeNewer(h.seq, scoreStore.seq))){
+      scoreStore.live = true;
+      scoreStore.sector = s;
+      scoreStore.seq = h.seq;
+    }
+  }
+
+  scoreStore.next = STORE_SLOTS; //Full unless an erased slot is found
+  for(uint16_t k = 1; scoreStore.live && (k < STORE_SLOTS); k++){
+    StoreRecord_t r;
+    flashRead(scoreStore.sector, k*STORE_RECORD_BYTES, &r, sizeof(r));
+    if(storeErased(&r)){ scoreStore.next = k; break; }
+    if(!storeRecordValid(&r)){ storeStats.badRecords++; continue; }
+    scoreStore.best[r.key] = max(scoreStore.best[r.key], r.score);
+    storeStats.records++;
+  }
+  storeStats.bootUs = micros() - start;
+}
+
+/** Score functions
+ *
+ * 1. scoreStoreBest --> best score saved for key
+ * 2. scoreStoreSubmit --> keep score if it beats the best of key, to be saved by scoreStoreIdle; returns true if it does
+ *
+ */
+uint16_t scoreStoreBest(uint8_t key){
+  return (key < STORE_KEYS) ? scoreStore.best[key] : 0;
+}
+
+bool scoreStoreSubmit(uint8_t key, uint16_t score){
+  if((key >= STORE_KEYS) || (score <= scoreStore.best[key])){ return false; }
+  scoreStore.best[key] = score;
+  scoreStore.dirty |= (uint32_t)1 << key;
+  return true;
+}
+
+/** Idle function
+ *
+ * Do the next flash operation, if any. Returns true if the flash was written
+ *
+ */
+bool storeWriteRecord(uint8_t s, uint16_t slot, uint8_t key){
+  StoreRecord_t r = {STORE_TAG, key, scoreStore.best[key], 0xFFFF, 0};
+  r.crc = storeCrc(&r, 6);
+  bool ok = flashProgram(s, slot*STORE_RECORD_BYTES, &r, sizeof(r));
+  if(!ok){ storeStats.failures++; }
+  return ok;
+}
+
+bool scoreStoreIdle(){
+  switch(scoreStore.step){
+    case STORE_IDLE: {
+      if(scoreStore.dirty == 0){ return false; }
+      if(!scoreStore.live || (scoreStore.next >= STORE_SLOTS)){ //No room: compact into the next sector
+        scoreStore.target = scoreStore.live ? (scoreStore.sector + 1) % FLASH_STORE_SECTORS : 0;
+        scoreStore.step = STORE_ERASE;
+        return scoreStoreIdle();
+      }
+      uint8_t key = __builtin_ctz(scoreStore.dirty);
+      if(storeWriteRecord(scoreStore.sector, scoreStore.next++, key)){ //A slot that did not verify is left behind
+        scoreStore.dirty &= ~((uint32_t)1 << key);
+        storeStats.appends++;
+      }
+      return true;
+    }
+    case STORE_ERASE:
+      flashEraseSector(scoreStore.target);
+      scoreStore.copyKey = 0;
+      scoreStore.copySlot = 1;
+      scoreStore.step = STORE_COPY;
+      return true;
+    case STORE_COPY:
+      while((scoreStore.copyKey < STORE_KEYS) && (scoreStore.best[scoreStore.copyKey] == 0)){ scoreStore.copyKey++; }
+      if(scoreStore.copyKey < STORE_KEYS){
+        uint8_t key = scoreStore.copyKey;
+        if(storeWriteRecord(scoreStore.target, scoreStore.copySlot++, key)){
+          scoreStore.dirty &= ~((uint32_t)1 << key); //Submitted again later, it is dirty again
+          scoreStore.copyKey++;
+        }
+        if(scoreStore.copySlot >= STORE_SLOTS){ scoreStore.step = STORE_ERASE; } //Too many bad slots: start over
+        return true;
+      }
+      scoreStore.step = STORE_SEAL; //The header is the next operation
+      // fall through
+    case STORE_SEAL: {
+      StoreHeader_t h = {STORE_MAGIC, (uint16_t)(scoreStore.seq + 1), 0xFFFF, 0};
+      h.crc = storeCrc(&h, 6);
+      if(!flashProgram(scoreStore.target, 0, &h, sizeof(h))){ //Header unusable: this sector will not do
+        storeStats.failures++;
+        scoreStore.target = (scoreStore.target + 1) % FLASH_STORE_SECTORS;
+        if(scoreStore.live && (scoreStore.target == scoreStore.sector)){ scoreStore.target = (scoreStore.target + 1) % FLASH_STORE_SECTORS; }
+        scoreStore.step = STORE_ERASE;
+        return true;
+      }
+      scoreStore.live = true;
+      scoreStore.sector = scoreStore.target;
+      scoreStore.seq = h.seq;
+      scoreStore.next = scoreStore.copySlot;
+      scoreStore.step = STORE_IDLE;
+      storeStats.compactions++;
+      return true;
+    }
+  }
+  return false;
+}
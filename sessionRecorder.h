@@ -0,0 +1,213 @@
+/**
+ * @file sessionRecorder.h
+ *
+ * @brief Game session record and replay: RNG seed, settings and per-frame inputs in a compact binary stream
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/** Session Stream
+ *
+ * A game only depends on the RNG seed, the settings and what the game loop reads in every frame, so that is all
+ * the stream holds. Multi-byte values are little endian.
+ * 1. Header --> magic, version, seed, car colour, car sprite, speedGain, vel00, waitTime, upperRandom, collectPoints, blocksNumber, driveMode,
+ *    lateLatch
+ * 2. Frame --> one flags byte: simulation steps (bits 0-2), button pressed (bits 3-4, 0 = none),
+ *    joystick changed (bit 5), accelerometer changed (bit 6); every changed pair follows as two 12-bit values in 3 bytes
+ * 3. End --> SESSION_END, score (16 bits) and frame of the collision (32 bits), checked by the replay
+ *
+ * When recording, the last game is kept in sessionBuffer; a game longer than the buffer is truncated.
+ * When replaying, the stream replaces the frame scheduler, the buttons and the ADC in the game loop.
+ *
+ */
+#ifndef SESSION_BYTES
+#define SESSION_BYTES 8192 //Record buffer: ~2 minutes of game at 30 Hz
+#endif
+#define SESSION_MAGIC0 'R'
+#define SESSION_MAGIC1 'G'
+#define SESSION_VERSION 7 //7: the spawn timer keeps its overshoot
+#define SESSION_END 0xFF //Never a valid flags byte: bit 7 is always clear
+
+typedef enum{
+  SESSION_OFF,
+  SESSION_RECORD,
+  SESSION_REPLAY
+}SessionMode_t;
+
+typedef struct{
+  uint32_t seed;
+  uint16_t carColour;
+  uint8_t carSprite;
+  uint16_t speedGain;
+  uint8_t vel00, waitTime, upperRandom, collectPoints, blocksNumber, driveMode;
+  uint8_t lateLatch; //Steering sampled after the blocks moved, right before the car is drawn
+}SessionHeader_t;
+
+typedef struct{
+  uint8_t mode; //SessionMode_t
+  bool maxSpeed; //Replay without waiting for the frame deadlines
+  const uint8_t *stream; //Replay source
+  uint32_t size; //Bytes recorded, or size of the replayed stream
+  uint32_t pos; //Next byte to replay
+  uint32_t frames; //Frames of the current game, also counted when not recording
+  bool truncated; //Recording did not fit in the buffer
+  bool ended; //End of the stream reached
+  bool replayed; //Last game was a replay...
+  bool matched; //...and ended with the recorded score and collision frame
+  uint16_t score; //End record: written when recording, read when replaying
+  uint32_t collisionFrame;
+  uint16_t joy[2], acc[2]; //Last pairs written or read
+  uint8_t flags; //Steps and button of the frame, until its inputs are known
+}Session_t;
+
+#ifndef SESSION_MODE
+#define SESSION_MODE SESSION_RECORD
+#endif
+
+uint8_t sessionBuffer[SESSION_BYTES];
+Session_t session = {SESSION_MODE, false, NULL, 0, 0, 0, false, false, false, false, 0, 0, {0, 0}, {0, 0}, 0};
+
+/** Byte stream functions
+ *
+ * sessionPut --> append n bytes of value to the record buffer (little endian)
+ * sessionGet --> read n bytes from the replayed stream (0 past its end)
+ *
+ */
+void sessionPut(uint32_t value, uint8_t n){
+  if(session.truncated || (session.size + n > SESSION_BYTES)){ session.truncated = true; return; } //Nothing after the first loss
+  for(uint8_t k = 0; k < n; k++){ sessionBuffer[session.size++] = value >> (8*k); }
+}
+
+uint32_t sessionGet(uint8_t n){
+  uint32_t value = 0;
+  for(uint8_t k = 0; k < n; k++){
+    if(session.pos >= session.size){ session.ended = true; return value; }
+    value |= (uint32_t)session.stream[session.pos++] << (8*k);
+  }
+  return value;
+}
+
+void sessionPutPair(const uint16_t *pair){
+  sessionPut((pair[0] & 0x0FFF) | ((uint32_t)(pair[1] & 0x0FFF) << 12), 3);
+}
+
+void sessionGetPair(uint16_t *pair){
+  uint32_t v = sessionGet(3);
+  pair[0] = v & 0x0FFF;
+  pair[1] = v >> 12;
+}
+
+/** Session control functions
+ *
+ * 1. sessionReplay --> replay stream in the next game (maxSpeed skips the countdown and the frame waits);
+ *    sessionReplay(sessionBuffer, session.size, ...) replays the game just recorded
+ * 2. sessionOpen --> start of a game: returns the header to apply, writes it when recording
+ * 3. sessionEvents, sessionInput --> every game frame, when the loop reads them: steps and button, then the inputs.
+ *    Both are recorded together by sessionInput, or overwritten with the replayed ones; sessionEvents returns false
+ *    when the replayed stream is over
+ * 4. sessionClose --> end of a game: writes the end record, or returns whether score and collision frame match it
+ *    and goes back to SESSION_MODE
+ * 5. sessionRealTime --> false when the frame deadlines must be ignored
+ *
+ */
+void sessionReplay(const uint8_t *stream, uint32_t size, bool maxSpeed){
+  session.mode = SESSION_REPLAY;
+  session.stream = stream;
+  session.size = size;
+  session.maxSpeed = maxSpeed;
+}
+
+bool sessionOpen(SessionHeader_t *h){
+  session.pos = 0;
+  session.frames = 0;
+  session.truncated = false;
+  session.ended = false;
+  memset(session.joy, 0xFF, sizeof(session.joy)); //Force the first frame to carry both pairs
+  memset(session.acc, 0xFF, sizeof(session.acc));
+
+  if(session.mode == SESSION_REPLAY){
+    SessionHeader_t r; //h is left untouched if the stream is not valid
+    if((sessionGet(1) != SESSION_MAGIC0) || (sessionGet(1) != SESSION_MAGIC1) || (sessionGet(1) != SESSION_VERSION)){ return false; }
+    r.seed = sessionGet(4);
+    r.carColour = sessionGet(2);
+    r.carSprite = sessionGet(1);
+    r.speedGain = sessionGet(2);
+    r.vel00 = sessionGet(1); r.waitTime = sessionGet(1); r.upperRandom = sessionGet(1);
+    r.collectPoints = sessionGet(1); r.blocksNumber = sessionGet(1); r.driveMode = sessionGet(1);
+    r.lateLatch = sessionGet(1);
+    if(session.ended){ return false; }
+    *h = r;
+    return true;
+  }
+
+  session.size = 0;
+  if(session.mode == SESSION_RECORD){
+    sessionPut(SESSION_MAGIC0, 1); sessionPut(SESSION_MAGIC1, 1); sessionPut(SESSION_VERSION, 1);
+    sessionPut(h->seed, 4);
+    sessionPut(h->carColour, 2);
+    sessionPut(h->carSprite, 1);
+    sessionPut(h->speedGain, 2);
+    sessionPut(h->vel00, 1); sessionPut(h->waitTime, 1); sessionPut(h->upperRandom, 1);
+    sessionPut(h->collectPoints, 1); sessionPut(h->blocksNumber, 1); sessionPut(h->driveMode, 1);
+    sessionPut(h->lateLatch, 1);
+  }
+  return true;
+}
+
+bool sessionEvents(uint8_t *steps, uint8_t *button){
+  if(session.mode == SESSION_REPLAY){
+    uint8_t flags = sessionGet(1);
+    if(session.ended){ return false; }
+    if(flags == SESSION_END){ session.pos--; return false; } //Left for sessionClose
+    *steps = flags & 0x07;
+    *button = (flags >> 3) & 0x03;
+    if(flags & 0x20){ sessionGetPair(session.joy); }
+    if(flags & 0x40){ sessionGetPair(session.acc); }
+  }
+  session.flags = (*steps & 0x07) | ((*button & 0x03) << 3);
+  return true;
+}
+
+void sessionInput(AdcFrame_t *input){
+  if(session.mode == SESSION_REPLAY){
+    input->value[ADC_JOY_X] = session.joy[0]; input->value[ADC_JOY_Y] = session.joy[1];
+    input->value[ADC_ACC_X] = session.acc[0]; input->value[ADC_ACC_Y] = session.acc[1];
+  }
+
+  if(session.mode == SESSION_RECORD){
+    uint16_t joy[2] = {input->value[ADC_JOY_X], input->value[ADC_JOY_Y]};
+    uint16_t acc[2] = {input->value[ADC_ACC_X], input->value[ADC_ACC_Y]};
+    bool joyChanged = memcmp(joy, session.joy, sizeof(joy)) != 0;
+    bool accChanged = memcmp(acc, session.acc, sizeof(acc)) != 0;
+    sessionPut(session.flags | (joyChanged ? 0x20 : 0) | (accChanged ? 0x40 : 0), 1);
+    if(joyChanged){ sessionPutPair(joy); memcpy(session.joy, joy, sizeof(joy)); }
+    if(accChanged){ sessionPutPair(acc); memcpy(session.acc, acc, sizeof(acc)); }
+  }
+  session.frames++;
+}
+
+bool sessionClose(uint16_t score, uint32_t collisionFrame){
+  session.replayed = (session.mode == SESSION_REPLAY);
+  if(session.mode == SESSION_RECORD){
+    sessionPut(SESSION_END, 1);
+    sessionPut(score, 2);
+    sessionPut(collisionFrame, 4);
+    session.score = score;
+    session.collisionFrame = collisionFrame;
+    return !session.truncated;
+  }
+  if(session.mode == SESSION_REPLAY){
+    session.mode = SESSION_MODE; //A replay is played once
+    session.matched = false;
+    if(!session.ended && (sessionGet(1) != SESSION_END)){ return false; } //Game over before the end of the stream
+    session.score = sessionGet(2);
+    session.collisionFrame = sessionGet(4);
+    session.matched = !session.ended && (session.score == score) && (session.collisionFrame == collisionFrame);
+    return session.matched;
+  }
+  return true;
+}
+
+bool sessionRealTime(){
+  return !((session.mode == SESSION_REPLAY) && session.maxSpeed);
+}
@@ -0,0 +1,40 @@
+/**
+ * @file sprites.h
+ *
+ * @brief Sprites: constant images of palette indices with a transparency key and a substitutable body colour
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/** Sprites
+ *
+ * 1. A sprite is a w*h table of palette indices (colours.h) kept in flash, one byte per pixel, row after row
+ * 2. SPRITE_CLEAR pixels are transparent: whatever is below them in the scene shows through
+ * 3. SPRITE_BODY pixels take the colour given when the sprite is drawn, so one artwork serves every car colour
+ * 4. Sprites are drawn by the compositor (compositorSprite), one scene row at a time, inside the damaged regions
+ *
+ */
+#define SPRITE_CLEAR 0xFF //Transparency key
+#define SPRITE_BODY 0xFE //Replaced by the body colour
+
+typedef struct{
+  uint8_t w, h;
+  const uint8_t *pixels; //w*h palette indices, row after row
+}Sprite_t;
+
+/** Sprite row function
+ *
+ * Paint row j of sprite s, placed with its left edge at column sx, over the scene pixels between columns x1 and x1+w-1
+ *
+ */
+void spritePaintRow(const Sprite_t *s, int16_t sx, int16_t j, uint16_t body, int16_t x1, int16_t w, uint16_t *out){
+  if((j < 0) || (j >= s->h)){ return; }
+  const uint8_t *p = s->pixels + (uint16_t)j*s->w;
+  int16_t a = max(sx, x1);
+  int16_t b = min((int16_t)(sx+s->w), (int16_t)(x1+w));
+  for(int16_t x = a; x < b; x++){
+    uint8_t c = p[x-sx];
+    if(c == SPRITE_CLEAR){ continue; }
+    out[x-x1] = (c == SPRITE_BODY) ? body : paletteColour(c);
+  }
+}
@@ -0,0 +1,145 @@
+/**
+ * @file textRenderer.h
+ *
+ * @brief Allocation-free text: const strings and numbers formatted in caller buffers, drawn glyph by glyph on the display bus; cached HUD fields
+ *
+ * @author Sara Sorrentino - Mirko Bellini - Vittoria Longo
+ */
+
+/** Text Renderer
+ *
+ * 1. Strings are const char arrays (kept in flash by the linker), numbers are formatted into buffers on the stack:
+ *    nothing goes through String, so nothing is taken from the heap
+ * 2. textDraw --> same pixels and arguments as gText (colour, background, horizontal and vertical scale), but a solid
+ *    glyph is pushed with one address window and a transparent one with one window per vertical run of dots,
+ *    instead of one window per dot
+ * 3. HUD fields --> remember the value on screen and, when it changes, damage (compositor.h) only the glyph cells that differ
+ *
+ */
+#define TEXT_MAX_SCALE 8 //Largest scale factor of textDraw
+#define TEXT_HUD_CHARS 10 //Longest text of a HUD field: any uint32_t
+
+typedef struct{
+  uint32_t draws; //textDraw calls
+  uint32_t glyphs; //Glyphs drawn
+  uint32_t hudCells; //HUD glyph cells damaged
+}TextStats_t;
+
+typedef struct{
+  int16_t x, y; //Top-left corner of the first glyph
+  uint32_t value; //Value on screen
+  bool valid; //false until the first value is shown
+  char text[TEXT_HUD_CHARS+1]; //Text on screen, drawn by the compositor
+}TextHud_t;
+
+TextStats_t textStats;
+bool textSolid = true; //Glyph background filled, as setFontSolid() of LCD_screen
+
+/** Format functions
+ *
+ * 1. formatNumber --> write n in decimal into text, which must hold at least 11 characters (6 for values below 65536)
+ * 2. formatLabel --> write label followed by n into text, which must hold strlen(label)+11 characters
+ *
+ */
+void formatNumber(uint32_t n, char *text){
+  char digits[TEXT_HUD_CHARS];
+  uint8_t k = 0;
+  do{ digits[k++] = '0' + n%10; n /= 10; }while(n > 0);
+  while(k > 0){ *text++ = digits[--k]; }
+  *text = 0;
+}
+
+void formatLabel(const char *label, uint32_t n, char *text){
+  while(*label){ *text++ = *label++; }
+  formatNumber(n, text);
+}
+
+/** Draw functions
+ *
+ * 1. textFontSolid --> choose whether the next texts fill their background
+ * 2. textGlyph --> draw one 6x8 cell at (x, y), clipped to the right and bottom edges of the panel
+ * 3. textDraw --> draw a string, each glyph FONT_WIDTH*ix pixels after the previous one
+ *
+ */
+void textFontSolid(bool flag){
+  textSolid = flag;
+}
+
+void textGlyph(int16_t x, int16_t y, char c, uint16_t colour, uint16_t back, uint8_t ix, uint8_t iy){
+  if((c < FONT_FIRST) || (c > FONT_LAST)){ c = ' '; }
+  const uint8_t *g = font5x7[c-FONT_FIRST];
+  int16_t w = min(FONT_WIDTH*ix, LCD_WIDTH-x), h = min(FONT_HEIGHT*iy, LCD_HEIGHT-y);
+  if((x < 0) || (y < 0) || (w <= 0) || (h <= 0)){ return; }
+  textStats.glyphs++;
+
+  if(textSolid){ //The whole cell in one window, one row of pixels at a time
+    uint16_t row[FONT_WIDTH*TEXT_MAX_SCALE];
+    lcdWindow(x, y, x+w-1, y+h-1);
+    for(int16_t j = 0; j < h; j++){
+      uint8_t bit = j/iy;
+      for(int16_t i = 0; i < w; i++){
+        uint8_t col = i/ix;
+        row[i] = ((col < FONT_WIDTH-1) && ((g[col] >> bit) & 0x01)) ? colour : back;
+      }
+      lcdPushPixels(row, w);
+    }
+    return;
+  }
+
+  for(uint8_t col = 0; col < FONT_WIDTH-1; col++){ //Transparent: one window per vertical run of dots
+    int16_t px = x + col*ix;
+    if(px >= LCD_WIDTH){ break; }
+    int16_t pw = min((int16_t)ix, (int16_t)(LCD_WIDTH-px));
+    uint8_t bit = 0;
+    while(bit < FONT_HEIGHT){
+      if(!((g[col] >> bit) & 0x01)){ bit++; continue; }
+      uint8_t first = bit;
+      while((bit < FONT_HEIGHT) && ((g[col] >> bit) & 0x01)){ bit++; }
+      int16_t py = y + first*iy;
+      int16_t ph = min((int16_t)((bit-first)*iy), (int16_t)(LCD_HEIGHT-py));
+      if(ph <= 0){ break; }
+      lcdWindow(px, py, px+pw-1, py+ph-1);
+      lcdPushColour(colour, (uint32_t)pw*ph);
+    }
+  }
+}
+
+void textDraw(int16_t x, int16_t y, const char *text, uint16_t colour = whiteColour, uint16_t back = blackColour, uint8_t ix = 1, uint8_t iy = 1){
+  ix = constrain(ix, 1, TEXT_MAX_SCALE);
+  iy = constrain(iy, 1, TEXT_MAX_SCALE);
+  textStats.draws++;
+  for(; *text; text++, x += FONT_WIDTH*ix){ textGlyph(x, y, *text, colour, back, ix, iy); }
+}
+
+/** HUD field functions
+ *
+ * 1. textHudReset --> place the field at (x, y); nothing is on screen yet, so the next value is damaged whole
+ * 2. textHudNumber --> show n: if it differs from the value on screen, format it and damage the cells that changed
+ *    (including the ones left empty by a shorter text); the field must be added to the scene with compositorText
+ *
+ */
+void textHudReset(TextHud_t *hud, int16_t x, int16_t y){
+  hud->x = x;
+  hud->y = y;
+  hud->valid = false;
+  hud->text[0] = 0;
+}
+
+void textHudNumber(TextHud_t *hud, uint32_t n){
+  if(hud->valid && (hud->value == n)){ return; }
+  char text[TEXT_HUD_CHARS+1];
+  formatNumber(n, text);
+  uint8_t k = 0;
+  for(bool oldEnd = false, newEnd = false; !(oldEnd && newEnd); k++){
+    oldEnd = oldEnd || (hud->text[k] == 0);
+    newEnd = newEnd || (text[k] == 0);
+    char was = oldEnd ? 0 : hud->text[k], now = newEnd ? 0 : text[k];
+    if(was != now){
+      compositorDamage(hud->x + k*FONT_WIDTH, hud->y, FONT_WIDTH, FONT_HEIGHT);
+      textStats.hudCells++;
+    }
+  }
+  strcpy(hud->text, text);
+  hud->value = n;
+  hud->valid = true;
+}